@@ -0,0 +1,110 @@
+#ifndef TREE_SITTER_HACK_BENCH_BASELINE_H_
+#define TREE_SITTER_HACK_BENCH_BASELINE_H_
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Baseline files shared by the benchmarks in bench/. Each line is a metric name, a tab and its
+ * value. Timing baselines are machine specific so they are stored under tmp/ rather than checked
+ * in. Reports that only depend on the grammar, like bench/parser-size.txt, are checked in.
+ */
+
+typedef struct {
+  const char *name;
+  double value;
+  // A metric regresses if it moves in the wrong direction by more than the threshold.
+  bool higher_is_better;
+  // Informational metrics describe the input and can't regress.
+  bool informational;
+} Metric;
+
+static inline double now_ns() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+static inline void save_baseline(const char *path, const Metric *metrics, unsigned count) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    fprintf(stderr, "Could not write baseline %s: %s\n", path, strerror(errno));
+    exit(1);
+  }
+  for (unsigned i = 0; i < count; i++) {
+    fprintf(file, "%s\t%f\n", metrics[i].name, metrics[i].value);
+  }
+  fclose(file);
+}
+
+// Returns the number of metrics that regressed by more than threshold percent.
+static inline unsigned compare_baseline(
+    const char *path,
+    const Metric *metrics,
+    unsigned count,
+    double threshold) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "No baseline at %s. Create one with --save %s\n", path, path);
+    return 0;
+  }
+
+  unsigned regressions = 0;
+  char name[64];
+  double previous;
+
+  printf("\n%-32s %14s %14s %8s\n", "metric", "baseline", "current", "change");
+
+  while (fscanf(file, "%63[^\t]\t%lf\n", name, &previous) == 2) {
+    for (unsigned i = 0; i < count; i++) {
+      if (strcmp(name, metrics[i].name) != 0) continue;
+
+      double change = previous != 0 ? (metrics[i].value - previous) * 100 / previous : 0;
+      bool regressed = !metrics[i].informational &&
+                       (metrics[i].higher_is_better ? -change : change) > threshold;
+
+      printf(
+          "%-32s %14.3f %14.3f %+7.1f%%%s\n",
+          name,
+          previous,
+          metrics[i].value,
+          change,
+          regressed ? "  REGRESSION" : "");
+
+      if (regressed) regressions++;
+    }
+  }
+
+  fclose(file);
+  return regressions;
+}
+
+// Compare and/or save a baseline. Returns the process exit status.
+static inline int finish_baseline(
+    const char *baseline,
+    const char *save,
+    const Metric *metrics,
+    unsigned count,
+    double threshold) {
+  unsigned regressions =
+      baseline != NULL ? compare_baseline(baseline, metrics, count, threshold) : 0;
+  if (save != NULL) save_baseline(save, metrics, count);
+
+  if (regressions > 0) {
+    fprintf(
+        stderr,
+        "\n%u metric%s regressed by more than %.1f%%\n",
+        regressions,
+        regressions == 1 ? "" : "s",
+        threshold);
+    return 1;
+  }
+
+  return 0;
+}
+
+#endif  // TREE_SITTER_HACK_BENCH_BASELINE_H_
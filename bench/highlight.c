@@ -0,0 +1,228 @@
+#include <tree_sitter/api.h>
+
+#include "../tools/read_file.h"
+#include "baseline.h"
+
+/**
+ * Highlight viewport benchmark. Reads file paths from stdin (one per line), parses each file and
+ * times running queries/highlights.scm over a few screen-sized viewports with
+ * ts_query_cursor_set_byte_range, the way an editor or code viewer rehighlights after a scroll or
+ * keystroke.
+ *
+ *     $ fd '\.(hack|php)$' examples | tmp/bench/highlight --lines 60 --baseline tmp/bench-hl
+ *
+ * Files are grouped by size. The time per viewport should be about the same in every group, so
+ * "flatness" is the time per viewport of the largest group divided by the smallest. Much more
+ * than 1 means a pattern or the tree makes the cursor do work proportional to the file.
+ */
+
+const TSLanguage *tree_sitter_hack(void);
+
+// Size groups, by upper bound in bytes.
+static const uint32_t group_limits[] = {16 << 10, 128 << 10, 1 << 20, UINT32_MAX};
+static const char *group_names[] = {"< 16KB", "16KB-128KB", "128KB-1MB", ">= 1MB"};
+
+#define GROUP_COUNT (sizeof(group_limits) / sizeof(group_limits[0]))
+
+// Viewports per file, spread evenly from the start to the end.
+#define VIEWPORTS 5
+
+enum {
+  METRIC_FILES,
+  METRIC_VIEWPORTS,
+  METRIC_CAPTURES_PER_VIEWPORT,
+  METRIC_US_PER_VIEWPORT,
+  METRIC_FLATNESS,
+  METRIC_COUNT,
+};
+
+typedef struct {
+  unsigned files;
+  unsigned viewports;
+  uint64_t captures;
+  double ns;
+} Group;
+
+// Byte offset of the start of line row, or length if the source has fewer lines.
+static uint32_t line_start(const char *source, uint32_t length, uint32_t row) {
+  uint32_t offset = 0;
+  for (uint32_t line = 0; line < row; line++) {
+    const char *newline = memchr(source + offset, '\n', length - offset);
+    if (newline == NULL) return length;
+    offset = newline - source + 1;
+  }
+  return offset;
+}
+
+static uint32_t count_lines(const char *source, uint32_t length) {
+  uint32_t lines = 1;
+  for (const char *c = source; (c = memchr(c, '\n', source + length - c)) != NULL; c++) lines++;
+  return lines;
+}
+
+// Run the query over [start, end) and return the number of captures.
+static unsigned highlight(
+    TSQueryCursor *cursor, const TSQuery *query, TSNode root, uint32_t start, uint32_t end) {
+  ts_query_cursor_set_byte_range(cursor, start, end);
+  ts_query_cursor_exec(cursor, query, root);
+
+  unsigned captures = 0;
+  TSQueryMatch match;
+  uint32_t index;
+  while (ts_query_cursor_next_capture(cursor, &match, &index)) captures++;
+  return captures;
+}
+
+static void usage() {
+  fprintf(
+      stderr,
+      "usage: highlight [--query FILE] [--lines N] [--iterations N] [--baseline FILE] [--save FILE]"
+      " [--threshold PERCENT] < paths\n");
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  const char *query_path = "queries/highlights.scm";
+  unsigned lines = 60;
+  unsigned iterations = 10;
+  const char *baseline = NULL;
+  const char *save = NULL;
+  double threshold = 10;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) usage();
+
+    if (strcmp(argv[i], "--query") == 0) {
+      query_path = argv[++i];
+    } else if (strcmp(argv[i], "--lines") == 0) {
+      lines = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--iterations") == 0) {
+      iterations = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--baseline") == 0) {
+      baseline = argv[++i];
+    } else if (strcmp(argv[i], "--save") == 0) {
+      save = argv[++i];
+    } else if (strcmp(argv[i], "--threshold") == 0) {
+      threshold = atof(argv[++i]);
+    } else {
+      usage();
+    }
+  }
+
+  if (lines == 0 || iterations == 0) usage();
+
+  uint32_t query_length;
+  char *query_source = read_file(query_path, &query_length);
+  if (query_source == NULL) {
+    fprintf(stderr, "Could not read %s: %s\n", query_path, strerror(errno));
+    return 1;
+  }
+
+  uint32_t error_offset;
+  TSQueryError error_type;
+  TSQuery *query =
+      ts_query_new(tree_sitter_hack(), query_source, query_length, &error_offset, &error_type);
+  if (query == NULL) {
+    fprintf(stderr, "%s: query error %d at byte %u\n", query_path, error_type, error_offset);
+    return 1;
+  }
+
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_hack());
+  TSQueryCursor *cursor = ts_query_cursor_new();
+  Group groups[GROUP_COUNT] = {{0}};
+
+  char path[4096];
+  while (fgets(path, sizeof(path), stdin) != NULL) {
+    path[strcspn(path, "\n")] = '\0';
+    if (path[0] == '\0') continue;
+
+    uint32_t length;
+    char *source = read_file(path, &length);
+    if (source == NULL) {
+      fprintf(stderr, "Could not read %s: %s\n", path, strerror(errno));
+      continue;
+    }
+
+    Group *group = &groups[0];
+    while (length >= group_limits[group - groups]) group++;
+
+    TSTree *tree = ts_parser_parse_string(parser, NULL, source, length);
+    TSNode root = ts_tree_root_node(tree);
+    uint32_t file_lines = count_lines(source, length);
+
+    // Files shorter than a viewport only have one.
+    unsigned viewports = file_lines > lines ? VIEWPORTS : 1;
+    for (unsigned i = 0; i < viewports; i++) {
+      uint32_t first_line =
+          viewports > 1 ? (uint64_t)(file_lines - lines) * i / (viewports - 1) : 0;
+      uint32_t start = line_start(source, length, first_line);
+      uint32_t end = line_start(source, length, first_line + lines);
+
+      double fastest = 0;
+      unsigned captures = 0;
+      for (unsigned iteration = 0; iteration < iterations; iteration++) {
+        double begin = now_ns();
+        captures = highlight(cursor, query, root, start, end);
+        double elapsed = now_ns() - begin;
+        if (iteration == 0 || elapsed < fastest) fastest = elapsed;
+      }
+
+      group->viewports++;
+      group->captures += captures;
+      group->ns += fastest;
+    }
+
+    group->files++;
+    ts_tree_delete(tree);
+    free(source);
+  }
+
+  printf(
+      "%-12s %8s %10s %14s %14s\n", "size", "files", "viewports", "captures/view", "us/viewport");
+
+  Group total = {0};
+  double smallest = 0, largest = 0;
+  for (unsigned i = 0; i < GROUP_COUNT; i++) {
+    const Group *group = &groups[i];
+    if (group->viewports == 0) continue;
+
+    double us = group->ns / group->viewports / 1e3;
+    printf(
+        "%-12s %8u %10u %14.1f %14.2f\n",
+        group_names[i],
+        group->files,
+        group->viewports,
+        (double)group->captures / group->viewports,
+        us);
+
+    if (smallest == 0) smallest = us;
+    largest = us;
+    total.files += group->files;
+    total.viewports += group->viewports;
+    total.captures += group->captures;
+    total.ns += group->ns;
+  }
+
+  double viewports = total.viewports > 0 ? total.viewports : 1;
+  Metric metrics[METRIC_COUNT] = {
+      [METRIC_FILES] = {"files", total.files, false, true},
+      [METRIC_VIEWPORTS] = {"viewports", total.viewports, false, true},
+      [METRIC_CAPTURES_PER_VIEWPORT] = {"captures/view", total.captures / viewports, false, true},
+      [METRIC_US_PER_VIEWPORT] = {"us/viewport", total.ns / viewports / 1e3, false, false},
+      [METRIC_FLATNESS] = {"flatness", smallest > 0 ? largest / smallest : 0, false, false},
+  };
+
+  printf("\n");
+  for (unsigned i = 0; i < METRIC_COUNT; i++) {
+    int precision = i >= METRIC_CAPTURES_PER_VIEWPORT ? 2 : 0;
+    printf("%-16s %.*f\n", metrics[i].name, precision, metrics[i].value);
+  }
+
+  ts_query_cursor_delete(cursor);
+  ts_parser_delete(parser);
+  ts_query_delete(query);
+  free(query_source);
+
+  return finish_baseline(baseline, save, metrics, METRIC_COUNT, threshold);
+}
@@ -0,0 +1,197 @@
+/**
+ * Keyword lexing benchmark. Tree-sitter runs ts_lex_keywords on every identifier (the grammar's
+ * word token) to check whether it's really a keyword, so its cost grows with the number of
+ * reserved words and how many identifiers share a prefix with one. Reads file paths from stdin
+ * (one per line), splits the files into identifier-shaped words and runs the generated keyword
+ * lexer over each with a mock lexer, so no Tree-sitter runtime is needed.
+ *
+ *     $ bin/benchmark-keywords --save tmp/bench-keywords-baseline
+ *     $ bin/benchmark-keywords --baseline tmp/bench-keywords-baseline
+ *
+ * "advances/word" counts characters the keyword lexer reads per word and doesn't depend on the
+ * machine, so it's the number to compare across grammar changes. Words read furthest without
+ * matching a keyword are listed with --top N.
+ */
+
+// Pull in the generated ts_lex_keywords.
+#include "../src/parser.c"
+
+#include "../tools/read_file.h"
+#include "baseline.h"
+#include "mock_lexer.h"
+
+enum {
+  METRIC_WORDS,
+  METRIC_KEYWORDS,
+  METRIC_ADVANCES_PER_WORD,
+  METRIC_NS_PER_WORD,
+  METRIC_COUNT,
+};
+
+typedef struct {
+  const char *text;
+  uint32_t length;
+  uint32_t advances;
+} Word;
+
+static bool is_word_start(unsigned char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c >= 0x80;
+}
+
+static bool is_word_char(unsigned char c) { return is_word_start(c) || (c >= '0' && c <= '9'); }
+
+// Most characters read without matching a keyword first.
+static int compare_words(const void *a, const void *b) {
+  const Word *x = a, *y = b;
+  if (x->advances != y->advances) return x->advances < y->advances ? 1 : -1;
+  if (x->length != y->length) return x->length < y->length ? -1 : 1;
+  return memcmp(x->text, y->text, x->length);
+}
+
+static volatile unsigned sink;
+
+static void usage() {
+  fprintf(
+      stderr,
+      "usage: keywords [--iterations N] [--top N] [--baseline FILE] [--save FILE]"
+      " [--threshold PERCENT] < paths\n");
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  unsigned iterations = 20;
+  unsigned top = 0;
+  const char *baseline = NULL;
+  const char *save = NULL;
+  double threshold = 10;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) usage();
+
+    if (strcmp(argv[i], "--iterations") == 0) {
+      iterations = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--top") == 0) {
+      top = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--baseline") == 0) {
+      baseline = argv[++i];
+    } else if (strcmp(argv[i], "--save") == 0) {
+      save = argv[++i];
+    } else if (strcmp(argv[i], "--threshold") == 0) {
+      threshold = atof(argv[++i]);
+    } else {
+      usage();
+    }
+  }
+
+  if (iterations == 0) usage();
+
+  // All files are kept in one buffer, the words point into it.
+  char *sources = NULL;
+  size_t sources_length = 0;
+  char path[4096];
+
+  while (fgets(path, sizeof(path), stdin) != NULL) {
+    path[strcspn(path, "\n")] = '\0';
+    if (path[0] == '\0') continue;
+
+    uint32_t length;
+    char *source = read_file(path, &length);
+    if (source == NULL) {
+      fprintf(stderr, "Could not read %s: %s\n", path, strerror(errno));
+      continue;
+    }
+
+    sources = realloc(sources, sources_length + length + 1);
+    memcpy(&sources[sources_length], source, length);
+    sources_length += length;
+    sources[sources_length++] = '\n';
+    free(source);
+  }
+
+  const char *end = sources + sources_length;
+  size_t capacity = 1024, count = 0;
+  Word *words = malloc(capacity * sizeof(Word));
+
+  for (const char *c = sources; c < end;) {
+    if (*c >= '0' && *c <= '9') {
+      // Skip whole numbers so 0x1f isn't counted as a word.
+      while (c < end && is_word_char(*c)) c++;
+      continue;
+    }
+
+    if (!is_word_start(*c)) {
+      c++;
+      continue;
+    }
+
+    const char *start = c;
+    while (c < end && is_word_char(*c)) c++;
+
+    if (count == capacity) {
+      capacity *= 2;
+      words = realloc(words, capacity * sizeof(Word));
+    }
+    words[count++] = (Word){start, c - start, 0};
+  }
+
+  MockLexer lexer;
+  mock_lexer_init(&lexer);
+
+  // Like the runtime, the keyword lexer starts at the identifier and sees the text after it.
+  uint64_t advances = 0, keywords = 0;
+  for (size_t i = 0; i < count; i++) {
+    mock_reset(&lexer, words[i].text, end - words[i].text, 0);
+
+    // The runtime only takes the keyword if it covers the whole identifier.
+    if (ts_lex_keywords(&lexer.base, 0) && lexer.token_end == words[i].length) {
+      keywords++;
+      words[i].advances = 0;
+    } else {
+      words[i].advances = lexer.advances;
+    }
+    advances += lexer.advances;
+  }
+
+  double fastest = 0;
+  for (unsigned iteration = 0; iteration < iterations; iteration++) {
+    double start = now_ns();
+    for (size_t i = 0; i < count; i++) {
+      mock_reset(&lexer, words[i].text, end - words[i].text, 0);
+      sink += ts_lex_keywords(&lexer.base, 0);
+    }
+    double elapsed = now_ns() - start;
+    if (iteration == 0 || elapsed < fastest) fastest = elapsed;
+  }
+
+  Metric metrics[METRIC_COUNT] = {
+      [METRIC_WORDS] = {"words", count, false, true},
+      [METRIC_KEYWORDS] = {"keywords", keywords, false, true},
+      [METRIC_ADVANCES_PER_WORD] =
+          {"advances/word", count > 0 ? (double)advances / count : 0, false, false},
+      [METRIC_NS_PER_WORD] = {"ns/word", count > 0 ? fastest / count : 0, false, false},
+  };
+
+  for (unsigned i = 0; i < METRIC_COUNT; i++) {
+    int precision = i >= METRIC_ADVANCES_PER_WORD ? 3 : 0;
+    printf("%-16s %.*f\n", metrics[i].name, precision, metrics[i].value);
+  }
+
+  if (top > 0) {
+    qsort(words, count, sizeof(Word), compare_words);
+    printf("\n%-32s %10s %10s\n", "word", "advances", "count");
+
+    unsigned printed = 0;
+    for (size_t i = 0; i < count && printed < top && words[i].advances > 0;) {
+      size_t same = i + 1;
+      while (same < count && compare_words(&words[i], &words[same]) == 0) same++;
+      printf("%-32.*s %10u %10zu\n", words[i].length, words[i].text, words[i].advances, same - i);
+      printed++;
+      i = same;
+    }
+  }
+
+  free(words);
+  free(sources);
+
+  return finish_baseline(baseline, save, metrics, METRIC_COUNT, threshold);
+}
@@ -0,0 +1,252 @@
+#include <inttypes.h>
+#include <tree_sitter/api.h>
+
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+#include "../tools/read_file.h"
+#include "baseline.h"
+
+/**
+ * Tree memory report. Reads file paths from stdin (one per line), parses each file and reports
+ * how many bytes its tree takes per byte of source, and which node kinds make up the tree.
+ *
+ *     $ fd '\.(hack|php)$' examples | tmp/bench/memory --top 20 --files 5
+ *
+ * Tree bytes are measured exactly: the heap in use before and after ts_tree_delete. The runtime
+ * doesn't expose the size of a single node, and hidden rules (`_`-prefixed, inlined) take memory
+ * without showing up as nodes, so the per-kind table counts visible nodes and their share of all
+ * nodes rather than bytes.
+ *
+ * "wrappers" counts nodes with exactly one child covering the same bytes. A kind that's mostly
+ * wrappers adds a node without adding information, and is a candidate for hiding in grammar.js.
+ */
+
+const TSLanguage *tree_sitter_hack(void);
+
+enum {
+  METRIC_FILES,
+  METRIC_BYTES,
+  METRIC_NODES,
+  METRIC_TREE_BYTES,
+  METRIC_TREE_BYTES_PER_BYTE,
+  METRIC_NODES_PER_KB,
+  METRIC_WRAPPER_PERCENT,
+  METRIC_COUNT,
+};
+
+typedef struct {
+  TSSymbol symbol;
+  uint64_t nodes;
+  uint64_t wrappers;
+} Kind;
+
+typedef struct {
+  char *path;
+  uint32_t length;
+  size_t tree_bytes;
+} File;
+
+static size_t heap_in_use() {
+#ifdef __APPLE__
+  malloc_statistics_t stats;
+  malloc_zone_statistics(NULL, &stats);
+  return stats.size_in_use;
+#else
+  return mallinfo2().uordblks;
+#endif
+}
+
+// ERROR is (TSSymbol)-1, so it's counted after the grammar's symbols.
+static Kind *kind_for(Kind *kinds, uint32_t symbol_count, TSSymbol symbol) {
+  return &kinds[symbol < symbol_count ? symbol : symbol_count];
+}
+
+static void count_kinds(TSNode root, Kind *kinds, uint32_t symbol_count) {
+  TSTreeCursor cursor = ts_tree_cursor_new(root);
+
+  for (;;) {
+    TSNode node = ts_tree_cursor_current_node(&cursor);
+    Kind *kind = kind_for(kinds, symbol_count, ts_node_symbol(node));
+    kind->nodes++;
+
+    if (ts_node_child_count(node) == 1) {
+      TSNode child = ts_node_child(node, 0);
+      if (ts_node_start_byte(child) == ts_node_start_byte(node) &&
+          ts_node_end_byte(child) == ts_node_end_byte(node)) {
+        kind->wrappers++;
+      }
+    }
+
+    if (ts_tree_cursor_goto_first_child(&cursor)) continue;
+
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        return;
+      }
+    }
+  }
+}
+
+static int compare_kinds(const void *a, const void *b) {
+  const Kind *x = a, *y = b;
+  if (x->nodes != y->nodes) return x->nodes < y->nodes ? 1 : -1;
+  return (x->symbol > y->symbol) - (x->symbol < y->symbol);
+}
+
+// Most tree bytes per source byte first.
+static int compare_files(const void *a, const void *b) {
+  const File *x = a, *y = b;
+  double ratio_x = (double)x->tree_bytes / (x->length > 0 ? x->length : 1);
+  double ratio_y = (double)y->tree_bytes / (y->length > 0 ? y->length : 1);
+  return (ratio_x < ratio_y) - (ratio_x > ratio_y);
+}
+
+static void usage() {
+  fprintf(
+      stderr,
+      "usage: memory [--top N] [--files N] [--baseline FILE] [--save FILE] [--threshold PERCENT]"
+      " < paths\n");
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  unsigned top = 20;
+  unsigned top_files = 0;
+  const char *baseline = NULL;
+  const char *save = NULL;
+  double threshold = 10;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) usage();
+
+    if (strcmp(argv[i], "--top") == 0) {
+      top = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--files") == 0) {
+      top_files = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--baseline") == 0) {
+      baseline = argv[++i];
+    } else if (strcmp(argv[i], "--save") == 0) {
+      save = argv[++i];
+    } else if (strcmp(argv[i], "--threshold") == 0) {
+      threshold = atof(argv[++i]);
+    } else {
+      usage();
+    }
+  }
+
+  const TSLanguage *language = tree_sitter_hack();
+  uint32_t symbol_count = ts_language_symbol_count(language);
+  Kind *kinds = calloc(symbol_count + 1, sizeof(Kind));
+  for (uint32_t i = 0; i < symbol_count; i++) kinds[i].symbol = i;
+  kinds[symbol_count].symbol = (TSSymbol)-1;
+
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, language);
+
+  size_t capacity = 1024, count = 0;
+  File *files = malloc(capacity * sizeof(File));
+  uint64_t total_bytes = 0, total_tree_bytes = 0;
+
+  char path[4096];
+  while (fgets(path, sizeof(path), stdin) != NULL) {
+    path[strcspn(path, "\n")] = '\0';
+    if (path[0] == '\0') continue;
+
+    uint32_t length;
+    char *source = read_file(path, &length);
+    if (source == NULL) {
+      fprintf(stderr, "Could not read %s: %s\n", path, strerror(errno));
+      continue;
+    }
+
+    TSTree *tree = ts_parser_parse_string(parser, NULL, source, length);
+    count_kinds(ts_tree_root_node(tree), kinds, symbol_count);
+
+    size_t with_tree = heap_in_use();
+    ts_tree_delete(tree);
+    size_t tree_bytes = with_tree - heap_in_use();
+
+    if (count == capacity) {
+      capacity *= 2;
+      files = realloc(files, capacity * sizeof(File));
+    }
+    files[count++] = (File){strdup(path), length, tree_bytes};
+
+    total_bytes += length;
+    total_tree_bytes += tree_bytes;
+    free(source);
+  }
+
+  uint64_t total_nodes = 0, total_wrappers = 0;
+  for (uint32_t i = 0; i <= symbol_count; i++) {
+    total_nodes += kinds[i].nodes;
+    total_wrappers += kinds[i].wrappers;
+  }
+
+  double kb = total_bytes / 1024.0;
+  double tree_bytes_per_byte = total_bytes > 0 ? (double)total_tree_bytes / total_bytes : 0;
+  double wrapper_percent = total_nodes > 0 ? 100.0 * total_wrappers / total_nodes : 0;
+  Metric metrics[METRIC_COUNT] = {
+      [METRIC_FILES] = {"files", count, false, true},
+      [METRIC_BYTES] = {"bytes", total_bytes, false, true},
+      [METRIC_NODES] = {"nodes", total_nodes, false, true},
+      [METRIC_TREE_BYTES] = {"tree bytes", total_tree_bytes, false, true},
+      [METRIC_TREE_BYTES_PER_BYTE] = {"tree bytes/byte", tree_bytes_per_byte, false, false},
+      [METRIC_NODES_PER_KB] = {"nodes/KB", kb > 0 ? total_nodes / kb : 0, false, false},
+      [METRIC_WRAPPER_PERCENT] = {"wrapper %", wrapper_percent, false, false},
+  };
+
+  for (unsigned i = 0; i < METRIC_COUNT; i++) {
+    int precision = i >= METRIC_TREE_BYTES_PER_BYTE ? 3 : 0;
+    printf("%-16s %.*f\n", metrics[i].name, precision, metrics[i].value);
+  }
+
+  if (top > 0) {
+    qsort(kinds, symbol_count + 1, sizeof(Kind), compare_kinds);
+    printf("\n%-40s %12s %10s %10s %10s\n", "kind", "nodes", "% nodes", "nodes/KB", "wrappers");
+
+    for (uint32_t i = 0; i < top && i <= symbol_count && kinds[i].nodes > 0; i++) {
+      const Kind *kind = &kinds[i];
+      const char *name = kind->symbol == (TSSymbol)-1
+                             ? "ERROR"
+                             : ts_language_symbol_name(language, kind->symbol);
+      bool named = ts_language_symbol_type(language, kind->symbol) == TSSymbolTypeRegular;
+
+      char label[64];
+      snprintf(label, sizeof(label), named ? "%s" : "\"%s\"", name);
+      printf(
+          "%-40s %12" PRIu64 " %10.2f %10.2f %9.1f%%\n",
+          label,
+          kind->nodes,
+          100.0 * kind->nodes / total_nodes,
+          kb > 0 ? kind->nodes / kb : 0,
+          100.0 * kind->wrappers / kind->nodes);
+    }
+  }
+
+  if (top_files > 0) {
+    qsort(files, count, sizeof(File), compare_files);
+    printf("\n%-60s %12s %12s %10s\n", "file", "bytes", "tree bytes", "ratio");
+
+    for (size_t i = 0; i < top_files && i < count; i++) {
+      printf(
+          "%-60s %12u %12zu %10.2f\n",
+          files[i].path,
+          files[i].length,
+          files[i].tree_bytes,
+          (double)files[i].tree_bytes / (files[i].length > 0 ? files[i].length : 1));
+    }
+  }
+
+  for (size_t i = 0; i < count; i++) free(files[i].path);
+  free(files);
+  free(kinds);
+  ts_parser_delete(parser);
+
+  return finish_baseline(baseline, save, metrics, METRIC_COUNT, threshold);
+}
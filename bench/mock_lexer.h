@@ -0,0 +1,107 @@
+#ifndef TREE_SITTER_HACK_BENCH_MOCK_LEXER_H_
+#define TREE_SITTER_HACK_BENCH_MOCK_LEXER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tree_sitter/parser.h>
+
+/**
+ * A TSLexer over an in-memory string for the benchmarks in bench/ that run the scanner or the
+ * generated lexers without the Tree-sitter runtime. Include it after src/parser.c.
+ *
+ *     MockLexer lexer;
+ *     mock_lexer_init(&lexer);
+ *     mock_reset(&lexer, input, length, 0);
+ *     ts_lex(&lexer.base, lex_state);
+ */
+
+typedef struct {
+  TSLexer base;
+  const char *input;
+  uint32_t length;
+  uint32_t position;
+  // Where the token starts, after the characters skipped since the last reset.
+  uint32_t token_start;
+  // The position at the last mark_end.
+  uint32_t token_end;
+  // Calls to advance since the last reset, including ones at the end of the input.
+  uint32_t advances;
+} MockLexer;
+
+static inline void mock_advance(TSLexer *lexer, bool skip) {
+  MockLexer *mock = (MockLexer *)lexer;
+  mock->advances++;
+  if (mock->position < mock->length) mock->position++;
+  if (skip) mock->token_start = mock->position;
+  lexer->lookahead =
+      mock->position < mock->length ? (unsigned char)mock->input[mock->position] : '\0';
+}
+
+static inline void mock_mark_end(TSLexer *lexer) {
+  MockLexer *mock = (MockLexer *)lexer;
+  mock->token_end = mock->position;
+}
+
+static inline uint32_t mock_get_column(TSLexer *lexer) {
+  (void)lexer;
+  return 0;
+}
+
+static inline bool mock_is_at_included_range_start(const TSLexer *lexer) {
+  (void)lexer;
+  return false;
+}
+
+static inline bool mock_eof(const TSLexer *lexer) {
+  const MockLexer *mock = (const MockLexer *)lexer;
+  return mock->position >= mock->length;
+}
+
+static inline void mock_lexer_init(MockLexer *mock) {
+  *mock = (MockLexer){
+      .base =
+          {
+              .advance = mock_advance,
+              .mark_end = mock_mark_end,
+              .get_column = mock_get_column,
+              .is_at_included_range_start = mock_is_at_included_range_start,
+              .eof = mock_eof,
+          },
+  };
+}
+
+// Start a token at position in input, like the runtime does before calling a lexer.
+static inline void mock_reset(
+    MockLexer *mock,
+    const char *input,
+    uint32_t length,
+    uint32_t position) {
+  mock->input = input;
+  mock->length = length;
+  mock->position = position;
+  mock->token_start = position;
+  mock->token_end = position;
+  mock->advances = 0;
+  mock->base.lookahead = position < length ? (unsigned char)input[position] : '\0';
+  mock->base.result_symbol = UINT16_MAX;
+}
+
+// A large fixture: line repeated count times followed by suffix, NUL terminated. Free it with
+// free.
+static inline char *repeat_line(
+    const char *line,
+    unsigned count,
+    const char *suffix,
+    uint32_t *length) {
+  size_t line_length = strlen(line);
+  char *source = malloc(line_length * count + strlen(suffix) + 1);
+  char *end = source;
+  for (unsigned i = 0; i < count; i++) end = stpcpy(end, line);
+  end = stpcpy(end, suffix);
+  *length = end - source;
+  return source;
+}
+
+#endif  // TREE_SITTER_HACK_BENCH_MOCK_LEXER_H_
@@ -0,0 +1,177 @@
+#include <sys/resource.h>
+#include <tree_sitter/api.h>
+
+#include "../tools/read_file.h"
+#include "baseline.h"
+
+/**
+ * Parse throughput benchmark. Reads file paths from stdin (one per line), parses each file with a
+ * single parser and reports files, bytes, nodes, bytes/sec, nodes/sec, p50/p99 per-file latency
+ * and peak RSS.
+ *
+ *     $ fd '\.(hack|php)$' examples | tmp/bench/parse --iterations 3 --baseline tmp/bench-baseline
+ *
+ * Timings only cover `ts_parser_parse_string`. Node counting happens outside the timed region.
+ * With --iterations N each file is parsed N times and the fastest parse is kept to reduce noise.
+ */
+
+const TSLanguage *tree_sitter_hack(void);
+
+enum {
+  METRIC_FILES,
+  METRIC_BYTES,
+  METRIC_NODES,
+  METRIC_BYTES_PER_SEC,
+  METRIC_NODES_PER_SEC,
+  METRIC_P50_MS,
+  METRIC_P99_MS,
+  METRIC_RSS_KB,
+  METRIC_COUNT,
+};
+
+static uint64_t count_nodes(TSNode root) {
+  uint64_t count = 1;
+  TSTreeCursor cursor = ts_tree_cursor_new(root);
+
+  for (;;) {
+    if (ts_tree_cursor_goto_first_child(&cursor)) {
+      count++;
+      continue;
+    }
+
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        return count;
+      }
+    }
+
+    count++;
+  }
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of a sorted array.
+static double percentile(const double *sorted, size_t length, unsigned percent) {
+  if (length == 0) return 0;
+  size_t rank = (length * percent + 99) / 100;
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static long peak_rss_kb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;  // Bytes on macOS, kilobytes elsewhere.
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+static void usage() {
+  fprintf(
+      stderr,
+      "usage: parse [--iterations N] [--baseline FILE] [--save FILE] [--threshold PERCENT]"
+      " < paths\n");
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  unsigned iterations = 1;
+  const char *baseline = NULL;
+  const char *save = NULL;
+  double threshold = 10;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) usage();
+
+    if (strcmp(argv[i], "--iterations") == 0) {
+      iterations = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--baseline") == 0) {
+      baseline = argv[++i];
+    } else if (strcmp(argv[i], "--save") == 0) {
+      save = argv[++i];
+    } else if (strcmp(argv[i], "--threshold") == 0) {
+      threshold = atof(argv[++i]);
+    } else {
+      usage();
+    }
+  }
+
+  if (iterations == 0) usage();
+
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_hack());
+
+  size_t capacity = 1024, files = 0;
+  double *latencies = malloc(capacity * sizeof(double));
+  double total_ms = 0;
+  uint64_t total_bytes = 0, total_nodes = 0;
+
+  char path[4096];
+  while (fgets(path, sizeof(path), stdin) != NULL) {
+    path[strcspn(path, "\n")] = '\0';
+    if (path[0] == '\0') continue;
+
+    uint32_t length;
+    char *source = read_file(path, &length);
+    if (source == NULL) {
+      fprintf(stderr, "Could not read %s: %s\n", path, strerror(errno));
+      continue;
+    }
+
+    double fastest = 0;
+    TSTree *tree = NULL;
+
+    for (unsigned i = 0; i < iterations; i++) {
+      if (tree != NULL) ts_tree_delete(tree);
+
+      double start = now_ns();
+      tree = ts_parser_parse_string(parser, NULL, source, length);
+      double elapsed = (now_ns() - start) / 1e6;
+
+      if (i == 0 || elapsed < fastest) fastest = elapsed;
+    }
+
+    total_nodes += count_nodes(ts_tree_root_node(tree));
+    total_bytes += length;
+    total_ms += fastest;
+
+    if (files == capacity) {
+      capacity *= 2;
+      latencies = realloc(latencies, capacity * sizeof(double));
+    }
+    latencies[files++] = fastest;
+
+    ts_tree_delete(tree);
+    free(source);
+  }
+
+  qsort(latencies, files, sizeof(double), compare_doubles);
+
+  double seconds = total_ms / 1e3;
+  Metric metrics[METRIC_COUNT] = {
+      [METRIC_FILES] = {"files", files, true, true},
+      [METRIC_BYTES] = {"bytes", total_bytes, true, true},
+      [METRIC_NODES] = {"nodes", total_nodes, true, true},
+      [METRIC_BYTES_PER_SEC] = {"bytes/sec", seconds > 0 ? total_bytes / seconds : 0, true, false},
+      [METRIC_NODES_PER_SEC] = {"nodes/sec", seconds > 0 ? total_nodes / seconds : 0, true, false},
+      [METRIC_P50_MS] = {"p50 ms", percentile(latencies, files, 50), false, false},
+      [METRIC_P99_MS] = {"p99 ms", percentile(latencies, files, 99), false, false},
+      [METRIC_RSS_KB] = {"rss KB", peak_rss_kb(), false, false},
+  };
+
+  for (unsigned i = 0; i < METRIC_COUNT; i++) {
+    int precision = i == METRIC_P50_MS || i == METRIC_P99_MS ? 3 : 0;
+    printf("%-10s %.*f\n", metrics[i].name, precision, metrics[i].value);
+  }
+
+  free(latencies);
+  ts_parser_delete(parser);
+
+  return finish_baseline(baseline, save, metrics, METRIC_COUNT, threshold);
+}
@@ -0,0 +1,72 @@
+/**
+ * Size report for the generated parser tables in src/parser.c. Large tables cost binary size and,
+ * more importantly, cache and TLB misses while parsing, so grammar changes should keep them in
+ * check. The report is checked in as bench/parser-size.txt:
+ *
+ *     $ bin/parser-size --baseline bench/parser-size.txt
+ *     $ bin/parser-size --save bench/parser-size.txt
+ *
+ * Sizes come from sizeof on the generated tables, so the numbers don't depend on the compiler.
+ */
+
+// Pull in the generated tables.
+#include "../src/parser.c"
+
+#include "baseline.h"
+
+#define TABLE(name) {#name " bytes", sizeof(name), false, false}
+
+static void usage() {
+  fprintf(stderr, "usage: parser-size [--baseline FILE] [--save FILE] [--threshold PERCENT]\n");
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  const char *baseline = NULL;
+  const char *save = NULL;
+  double threshold = 10;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) usage();
+
+    if (strcmp(argv[i], "--baseline") == 0) {
+      baseline = argv[++i];
+    } else if (strcmp(argv[i], "--save") == 0) {
+      save = argv[++i];
+    } else if (strcmp(argv[i], "--threshold") == 0) {
+      threshold = atof(argv[++i]);
+    } else {
+      usage();
+    }
+  }
+
+  Metric metrics[] = {
+      {"state count", STATE_COUNT, false, false},
+      {"large state count", LARGE_STATE_COUNT, false, false},
+      {"symbol count", SYMBOL_COUNT, false, false},
+      {"token count", TOKEN_COUNT, false, true},
+      {"field count", FIELD_COUNT, false, true},
+      {"production id count", PRODUCTION_ID_COUNT, false, false},
+      TABLE(ts_parse_table),
+      TABLE(ts_small_parse_table),
+      TABLE(ts_small_parse_table_map),
+      TABLE(ts_parse_actions),
+      TABLE(ts_lex_modes),
+      TABLE(ts_primary_state_ids),
+      TABLE(ts_alias_sequences),
+      TABLE(ts_field_map_entries),
+      {"total table bytes",
+       sizeof(ts_parse_table) + sizeof(ts_small_parse_table) + sizeof(ts_small_parse_table_map) +
+           sizeof(ts_parse_actions) + sizeof(ts_lex_modes) + sizeof(ts_primary_state_ids) +
+           sizeof(ts_alias_sequences) + sizeof(ts_field_map_entries),
+       false,
+       false},
+  };
+  unsigned count = sizeof(metrics) / sizeof(metrics[0]);
+
+  for (unsigned i = 0; i < count; i++) {
+    printf("%-32s %12.0f\n", metrics[i].name, metrics[i].value);
+  }
+
+  return finish_baseline(baseline, save, metrics, count, threshold);
+}
@@ -0,0 +1,488 @@
+#include <tree_sitter/api.h>
+
+#include "../tools/read_file.h"
+#include "baseline.h"
+
+/**
+ * Incremental reparse harness. Replays recorded edit sequences one keystroke at a time the way an
+ * editor would: apply the keystroke to the document, `ts_tree_edit` the previous tree, reparse with
+ * it and check the result against a fresh parse of the same text. Takes edit files as arguments,
+ * bin/reparse replays everything in bench/edits:
+ *
+ *     $ tmp/bench/reparse --worst 10 bench/edits/xhp.edits bench/edits/heredoc.edits
+ *
+ * Each NAME.edits replays against the document in NAME.hack next to it. Lines are tab separated,
+ * `#` starts a comment and `\n`, `\t` and `\\` escape the text and anchor:
+ *
+ *     type	ANCHOR	TEXT    Type TEXT a byte at a time right after the first ANCHOR.
+ *     erase	ANCHOR	N       Delete the N bytes after the first ANCHOR a byte at a time.
+ *
+ * Anchors are looked up in the document as edited so far. Reports reparse and fresh parse latency
+ * per sequence and the keystrokes with the largest changed ranges, which is where a single
+ * keystroke invalidates most of the tree. Exits with 1 if an incremental parse differs from the
+ * fresh one. With --iterations N each parse is repeated N times and the fastest is kept.
+ */
+
+const TSLanguage *tree_sitter_hack(void);
+
+enum {
+  METRIC_SEQUENCES,
+  METRIC_KEYSTROKES,
+  METRIC_REPARSE_P50_MS,
+  METRIC_REPARSE_P99_MS,
+  METRIC_FRESH_P50_MS,
+  METRIC_CHANGED_BYTES_MEAN,
+  METRIC_CHANGED_BYTES_MAX,
+  METRIC_COUNT,
+};
+
+typedef struct {
+  const char *sequence;
+  // Line of the edit in the .edits file.
+  unsigned line;
+  TSPoint point;
+  uint32_t document_bytes;
+  uint32_t changed_bytes;
+  double reparse_ms;
+  double fresh_ms;
+} Keystroke;
+
+typedef struct {
+  Keystroke *keystrokes;
+  size_t count;
+  size_t capacity;
+  unsigned mismatches;
+} Results;
+
+typedef struct {
+  const char *path;
+  unsigned line;
+  char *source;
+  uint32_t length;
+  TSParser *parser;
+  TSParser *fresh_parser;
+  TSTree *tree;
+  unsigned iterations;
+  Results *results;
+} Replay;
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Largest changed range first.
+static int compare_keystrokes(const void *a, const void *b) {
+  const Keystroke *x = a, *y = b;
+  if (x->changed_bytes != y->changed_bytes) return x->changed_bytes < y->changed_bytes ? 1 : -1;
+  return (x->reparse_ms < y->reparse_ms) - (x->reparse_ms > y->reparse_ms);
+}
+
+// Nearest-rank percentile of a sorted array.
+static double percentile(const double *sorted, size_t length, unsigned percent) {
+  if (length == 0) return 0;
+  size_t rank = (length * percent + 99) / 100;
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Unescape \n, \t and \\ in place.
+static void unescape(char *text) {
+  char *to = text;
+  for (char *from = text; *from != '\0'; from++) {
+    if (*from == '\\' && from[1] != '\0') {
+      from++;
+      *to++ = *from == 'n' ? '\n' : *from == 't' ? '\t' : *from;
+    } else {
+      *to++ = *from;
+    }
+  }
+  *to = '\0';
+}
+
+static TSPoint point_at(const char *source, uint32_t byte) {
+  TSPoint point = {0, 0};
+  for (uint32_t i = 0; i < byte; i++) {
+    if (source[i] == '\n') {
+      point.row++;
+      point.column = 0;
+    } else {
+      point.column++;
+    }
+  }
+  return point;
+}
+
+static TSPoint point_after(TSPoint point, char c) {
+  return c == '\n' ? (TSPoint){point.row + 1, 0} : (TSPoint){point.row, point.column + 1};
+}
+
+static TSTree *parse(TSParser *parser, TSTree *old_tree, Replay *replay, double *fastest) {
+  TSTree *tree = NULL;
+
+  for (unsigned i = 0; i < replay->iterations; i++) {
+    if (tree != NULL) ts_tree_delete(tree);
+
+    double start = now_ns();
+    tree = ts_parser_parse_string(parser, old_tree, replay->source, replay->length);
+    double elapsed = (now_ns() - start) / 1e6;
+
+    if (i == 0 || elapsed < *fastest) *fastest = elapsed;
+  }
+
+  return tree;
+}
+
+static bool same_node(TSTreeCursor *a, TSTreeCursor *b) {
+  TSNode x = ts_tree_cursor_current_node(a), y = ts_tree_cursor_current_node(b);
+  return ts_node_symbol(x) == ts_node_symbol(y) &&
+         ts_node_start_byte(x) == ts_node_start_byte(y) &&
+         ts_node_end_byte(x) == ts_node_end_byte(y) &&
+         ts_node_is_missing(x) == ts_node_is_missing(y) &&
+         ts_node_child_count(x) == ts_node_child_count(y) &&
+         ts_tree_cursor_current_field_id(a) == ts_tree_cursor_current_field_id(b);
+}
+
+// Compare both trees node by node. Sets difference to the first node of fresh that differs.
+static bool same_tree(TSTree *incremental, TSTree *fresh, TSNode *difference) {
+  TSTreeCursor a = ts_tree_cursor_new(ts_tree_root_node(incremental));
+  TSTreeCursor b = ts_tree_cursor_new(ts_tree_root_node(fresh));
+  bool same = true;
+
+  // Nodes only match if their child counts do, so both cursors always move the same way.
+  for (;;) {
+    if (!same_node(&a, &b)) {
+      *difference = ts_tree_cursor_current_node(&b);
+      same = false;
+      break;
+    }
+
+    if (ts_tree_cursor_goto_first_child(&a)) {
+      ts_tree_cursor_goto_first_child(&b);
+      continue;
+    }
+
+    bool done = false;
+    while (!ts_tree_cursor_goto_next_sibling(&a)) {
+      ts_tree_cursor_goto_parent(&b);
+      if (!ts_tree_cursor_goto_parent(&a)) {
+        done = true;
+        break;
+      }
+    }
+    if (done) break;
+    ts_tree_cursor_goto_next_sibling(&b);
+  }
+
+  ts_tree_cursor_delete(&a);
+  ts_tree_cursor_delete(&b);
+  return same;
+}
+
+// Apply a one byte edit at start: delete the byte there, or insert c if it's not NUL.
+static void keystroke(Replay *replay, uint32_t start, char c) {
+  TSPoint start_point = point_at(replay->source, start);
+  TSInputEdit edit = {start, start, start, start_point, start_point, start_point};
+
+  if (c == '\0') {
+    edit.old_end_byte = start + 1;
+    edit.old_end_point = point_after(start_point, replay->source[start]);
+    memmove(&replay->source[start], &replay->source[start + 1], replay->length - start);
+    replay->length--;
+  } else {
+    edit.new_end_byte = start + 1;
+    edit.new_end_point = point_after(start_point, c);
+    replay->source = realloc(replay->source, replay->length + 2);
+    memmove(&replay->source[start + 1], &replay->source[start], replay->length - start + 1);
+    replay->source[start] = c;
+    replay->length++;
+  }
+
+  Keystroke result = {replay->path, replay->line, start_point, replay->length, 0, 0, 0};
+
+  ts_tree_edit(replay->tree, &edit);
+  TSTree *tree = parse(replay->parser, replay->tree, replay, &result.reparse_ms);
+  TSTree *fresh = parse(replay->fresh_parser, NULL, replay, &result.fresh_ms);
+
+  uint32_t range_count;
+  TSRange *ranges = ts_tree_get_changed_ranges(replay->tree, tree, &range_count);
+  for (uint32_t i = 0; i < range_count; i++) {
+    result.changed_bytes += ranges[i].end_byte - ranges[i].start_byte;
+  }
+  free(ranges);
+
+  TSNode difference;
+  if (!same_tree(tree, fresh, &difference)) {
+    TSPoint point = ts_node_start_point(difference);
+    fprintf(
+        stderr,
+        "%s:%u: reparse at %u:%u differs from a fresh parse at %u:%u (%s)\n",
+        replay->path,
+        replay->line,
+        start_point.row + 1,
+        start_point.column + 1,
+        point.row + 1,
+        point.column + 1,
+        ts_node_type(difference));
+    replay->results->mismatches++;
+  }
+
+  ts_tree_delete(fresh);
+  ts_tree_delete(replay->tree);
+  replay->tree = tree;
+
+  Results *results = replay->results;
+  if (results->count == results->capacity) {
+    results->capacity = results->capacity > 0 ? results->capacity * 2 : 1024;
+    results->keystrokes = realloc(results->keystrokes, results->capacity * sizeof(Keystroke));
+  }
+  results->keystrokes[results->count++] = result;
+}
+
+static void fail(Replay *replay, const char *message) {
+  fprintf(stderr, "%s:%u: %s\n", replay->path, replay->line, message);
+  exit(1);
+}
+
+static void replay_edit(Replay *replay, char *edit) {
+  char *op = strtok(edit, "\t");
+  char *anchor = strtok(NULL, "\t");
+  char *argument = strtok(NULL, "");
+  if (op == NULL || anchor == NULL || argument == NULL) fail(replay, "expected OP\tANCHOR\tTEXT");
+
+  unescape(anchor);
+  unescape(argument);
+
+  char *found = strstr(replay->source, anchor);
+  if (found == NULL) fail(replay, "anchor not found");
+  uint32_t cursor = found - replay->source + strlen(anchor);
+
+  if (strcmp(op, "type") == 0) {
+    for (char *c = argument; *c != '\0'; c++) keystroke(replay, cursor++, *c);
+  } else if (strcmp(op, "erase") == 0) {
+    int count = atoi(argument);
+    if (count <= 0 || cursor + count > replay->length) fail(replay, "bad erase count");
+    for (int i = 0; i < count; i++) keystroke(replay, cursor, '\0');
+  } else {
+    fail(replay, "unknown edit, expected type or erase");
+  }
+}
+
+static void replay_sequence(
+    const char *path,
+    TSParser *parser,
+    TSParser *fresh_parser,
+    unsigned iterations,
+    Results *results) {
+  size_t length = strlen(path);
+  if (length < 6 || strcmp(&path[length - 6], ".edits") != 0) {
+    fprintf(stderr, "Expected a .edits file: %s\n", path);
+    exit(1);
+  }
+
+  char *document = malloc(length);
+  memcpy(document, path, length - 6);
+  strcpy(&document[length - 6], ".hack");
+
+  uint32_t edits_length;
+  char *edits = read_file(path, &edits_length);
+  Replay replay = {path, 0, NULL, 0, parser, fresh_parser, NULL, iterations, results};
+  replay.source = read_file(document, &replay.length);
+
+  if (edits == NULL || replay.source == NULL) {
+    fprintf(stderr, "Could not read %s: %s\n", edits == NULL ? path : document, strerror(errno));
+    exit(1);
+  }
+
+  replay.tree = ts_parser_parse_string(parser, NULL, replay.source, replay.length);
+
+  // Split lines by hand, replay_edit uses strtok.
+  char *line = edits;
+  while (line != NULL) {
+    char *end = strchr(line, '\n');
+    if (end != NULL) *end = '\0';
+    replay.line++;
+
+    if (line[0] != '\0' && line[0] != '#') replay_edit(&replay, line);
+    line = end != NULL ? end + 1 : NULL;
+  }
+
+  ts_tree_delete(replay.tree);
+  free(replay.source);
+  free(edits);
+  free(document);
+}
+
+typedef struct {
+  double reparse_p50_ms;
+  double reparse_p99_ms;
+  double fresh_p50_ms;
+  double changed_bytes_mean;
+  uint32_t changed_bytes_max;
+} Summary;
+
+static Summary summarize(const Keystroke *keystrokes, size_t count) {
+  double *reparse = malloc((count > 0 ? count : 1) * sizeof(double));
+  double *fresh = malloc((count > 0 ? count : 1) * sizeof(double));
+  uint64_t changed = 0;
+  Summary summary = {0, 0, 0, 0, 0};
+
+  for (size_t i = 0; i < count; i++) {
+    reparse[i] = keystrokes[i].reparse_ms;
+    fresh[i] = keystrokes[i].fresh_ms;
+    changed += keystrokes[i].changed_bytes;
+    if (keystrokes[i].changed_bytes > summary.changed_bytes_max) {
+      summary.changed_bytes_max = keystrokes[i].changed_bytes;
+    }
+  }
+
+  qsort(reparse, count, sizeof(double), compare_doubles);
+  qsort(fresh, count, sizeof(double), compare_doubles);
+
+  summary.reparse_p50_ms = percentile(reparse, count, 50);
+  summary.reparse_p99_ms = percentile(reparse, count, 99);
+  summary.fresh_p50_ms = percentile(fresh, count, 50);
+  summary.changed_bytes_mean = count > 0 ? (double)changed / count : 0;
+
+  free(reparse);
+  free(fresh);
+  return summary;
+}
+
+static void usage() {
+  fprintf(
+      stderr,
+      "usage: reparse [--iterations N] [--worst N] [--baseline FILE] [--save FILE]"
+      " [--threshold PERCENT] EDITS...\n");
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  unsigned iterations = 1;
+  unsigned worst = 10;
+  const char *baseline = NULL;
+  const char *save = NULL;
+  double threshold = 10;
+
+  int i = 1;
+  for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+    if (i + 1 >= argc) usage();
+
+    if (strcmp(argv[i], "--iterations") == 0) {
+      iterations = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--worst") == 0) {
+      worst = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--baseline") == 0) {
+      baseline = argv[++i];
+    } else if (strcmp(argv[i], "--save") == 0) {
+      save = argv[++i];
+    } else if (strcmp(argv[i], "--threshold") == 0) {
+      threshold = atof(argv[++i]);
+    } else {
+      usage();
+    }
+  }
+  int first_path = i;
+
+  if (iterations == 0 || first_path == argc) usage();
+
+  TSParser *parser = ts_parser_new();
+  TSParser *fresh_parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_hack());
+  ts_parser_set_language(fresh_parser, tree_sitter_hack());
+
+  Results results = {NULL, 0, 0, 0};
+
+  printf(
+      "%-32s %10s %10s %10s %10s %10s %10s\n",
+      "sequence",
+      "keystrokes",
+      "p50 ms",
+      "p99 ms",
+      "fresh ms",
+      "changed",
+      "max");
+
+  for (i = first_path; i < argc; i++) {
+    size_t start = results.count;
+    replay_sequence(argv[i], parser, fresh_parser, iterations, &results);
+
+    Summary summary = summarize(&results.keystrokes[start], results.count - start);
+    printf(
+        "%-32s %10zu %10.3f %10.3f %10.3f %10.0f %10u\n",
+        argv[i],
+        results.count - start,
+        summary.reparse_p50_ms,
+        summary.reparse_p99_ms,
+        summary.fresh_p50_ms,
+        summary.changed_bytes_mean,
+        summary.changed_bytes_max);
+  }
+
+  size_t count = results.count;
+  Summary summary = summarize(results.keystrokes, count);
+  qsort(results.keystrokes, count, sizeof(Keystroke), compare_keystrokes);
+
+  if (worst > 0 && count > 0) {
+    printf(
+        "\n%-40s %10s %10s %10s %10s\n",
+        "largest changed ranges",
+        "changed",
+        "document",
+        "reparse ms",
+        "fresh ms");
+
+    for (size_t i = 0; i < count && i < worst; i++) {
+      const Keystroke *keystroke = &results.keystrokes[i];
+      char location[4096];
+      snprintf(
+          location,
+          sizeof(location),
+          "%s:%u @ %u:%u",
+          keystroke->sequence,
+          keystroke->line,
+          keystroke->point.row + 1,
+          keystroke->point.column + 1);
+      printf(
+          "%-40s %10u %10u %10.3f %10.3f\n",
+          location,
+          keystroke->changed_bytes,
+          keystroke->document_bytes,
+          keystroke->reparse_ms,
+          keystroke->fresh_ms);
+    }
+  }
+
+  Metric metrics[METRIC_COUNT] = {
+      [METRIC_SEQUENCES] = {"sequences", argc - first_path, false, true},
+      [METRIC_KEYSTROKES] = {"keystrokes", count, false, true},
+      [METRIC_REPARSE_P50_MS] = {"reparse p50 ms", summary.reparse_p50_ms, false, false},
+      [METRIC_REPARSE_P99_MS] = {"reparse p99 ms", summary.reparse_p99_ms, false, false},
+      [METRIC_FRESH_P50_MS] = {"fresh p50 ms", summary.fresh_p50_ms, false, false},
+      [METRIC_CHANGED_BYTES_MEAN] =
+          {"changed bytes mean", summary.changed_bytes_mean, false, false},
+      [METRIC_CHANGED_BYTES_MAX] = {"changed bytes max", summary.changed_bytes_max, false, false},
+  };
+
+  printf("\n");
+  for (unsigned i = 0; i < METRIC_COUNT; i++) {
+    int precision = i >= METRIC_REPARSE_P50_MS && i <= METRIC_FRESH_P50_MS ? 3 : 0;
+    printf("%-20s %.*f\n", metrics[i].name, precision, metrics[i].value);
+  }
+
+  free(results.keystrokes);
+  ts_parser_delete(parser);
+  ts_parser_delete(fresh_parser);
+
+  int status = finish_baseline(baseline, save, metrics, METRIC_COUNT, threshold);
+
+  if (results.mismatches > 0) {
+    fprintf(
+        stderr,
+        "\n%u keystroke%s reparsed differently from a fresh parse\n",
+        results.mismatches,
+        results.mismatches == 1 ? "" : "s");
+    return 1;
+  }
+
+  return status;
+}
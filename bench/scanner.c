@@ -0,0 +1,190 @@
+/**
+ * External scanner micro-benchmark. Times tree_sitter_hack_external_scanner_deserialize followed by
+ * tree_sitter_hack_external_scanner_scan for every combination of valid external tokens the
+ * generated parser can ask for (ts_external_scanner_states) against a few fixtures, using a mock
+ * lexer so no Tree-sitter runtime is needed.
+ *
+ *     $ bin/benchmark-scanner --save tmp/bench-scanner-baseline
+ *     $ bin/benchmark-scanner --baseline tmp/bench-scanner-baseline
+ *
+ * The "restore" metrics time deserialize on its own. Restoring an empty state is the common case
+ * (no open heredoc) and must not depend on the length of any previously seen delimiter.
+ */
+
+// Pull in the generated tables for ts_external_scanner_states and the scanner itself.
+#include "../src/parser.c"
+#include "../src/scanner.c"
+
+#include "baseline.h"
+#include "mock_lexer.h"
+
+typedef struct {
+  const char *name;
+  // Serialized scanner state: is_nowdoc, did_start, did_end followed by the delimiter. NULL when
+  // there is no open heredoc.
+  const char *state;
+  unsigned state_length;
+  // Input starting at the position where the scanner is invoked.
+  const char *input;
+} Fixture;
+
+static Fixture fixtures[] = {
+    {"code", NULL, 0, " foo($bar);\n"},
+    // Error recovery calls the scanner with every token valid, so scan_start skips indentation.
+    {"indented code", NULL, 0, "\n            \n            foo($bar);\n"},
+    {"start", NULL, 0, "SQL\nSELECT * FROM users WHERE id = $id\nSQL;\n"},
+    {"body", "\0\1\0SQL", 6, "SELECT * FROM users WHERE id = $id AND name = {$user->name}\nSQL;\n"},
+    {"nowdoc", "\1\1\0JSON", 7, "{\"users\": [{\"id\": 1, \"name\": \"$name\"}]}\nJSON;\n"},
+    {"end", "\0\1\1SQL", 6, "\nSQL;\n"},
+    // Filled in by large_body().
+    {"large body", "\0\1\0SQL", 6, NULL},
+    {"large nowdoc", "\1\1\0SQL", 6, NULL},
+};
+
+// A large embedded SQL query, the kind of heredoc that dominates scanner time in practice.
+static const char *large_body() {
+  static char *body;
+  uint32_t length;
+  if (body == NULL) {
+    body = repeat_line(
+        "  SELECT id, name, email FROM users WHERE org_id = 42 AND deleted = 0\n",
+        256,
+        "SQL;\n",
+        &length);
+  }
+  return body;
+}
+
+#define FIXTURE_COUNT (sizeof(fixtures) / sizeof(fixtures[0]))
+#define STATE_COUNT_EXTERNAL (sizeof(ts_external_scanner_states) / sizeof(ts_external_scanner_states[0]))
+
+// Restore cases plus one case per fixture for every non-empty external scanner state.
+#define MAX_METRICS (4 + FIXTURE_COUNT * STATE_COUNT_EXTERNAL)
+
+static volatile unsigned sink;
+
+static double time_restore(
+    void *scanner,
+    const char *state,
+    unsigned length,
+    unsigned long iterations) {
+  double start = now_ns();
+  for (unsigned long i = 0; i < iterations; i++) {
+    tree_sitter_hack_external_scanner_deserialize(scanner, state, length);
+    sink += ((Scanner *)scanner)->delimiter.len;
+  }
+  return (now_ns() - start) / iterations;
+}
+
+static double time_scan(
+    void *scanner,
+    const Fixture *fixture,
+    const bool *expected,
+    unsigned long iterations,
+    TSSymbol *result) {
+  MockLexer lexer;
+  mock_lexer_init(&lexer);
+  uint32_t length = strlen(fixture->input);
+
+  bool found = false;
+  double start = now_ns();
+  for (unsigned long i = 0; i < iterations; i++) {
+    tree_sitter_hack_external_scanner_deserialize(scanner, fixture->state, fixture->state_length);
+    mock_reset(&lexer, fixture->input, length, 0);
+    found = tree_sitter_hack_external_scanner_scan(scanner, &lexer.base, expected);
+    sink += lexer.base.result_symbol;
+  }
+  double elapsed = (now_ns() - start) / iterations;
+
+  *result = found ? lexer.base.result_symbol : UINT16_MAX;
+  return elapsed;
+}
+
+static void usage() {
+  fprintf(
+      stderr,
+      "usage: scanner [--iterations N] [--baseline FILE] [--save FILE] [--threshold PERCENT]\n");
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  unsigned long iterations = 1000000;
+  const char *baseline = NULL;
+  const char *save = NULL;
+  double threshold = 10;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) usage();
+
+    if (strcmp(argv[i], "--iterations") == 0) {
+      iterations = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--baseline") == 0) {
+      baseline = argv[++i];
+    } else if (strcmp(argv[i], "--save") == 0) {
+      save = argv[++i];
+    } else if (strcmp(argv[i], "--threshold") == 0) {
+      threshold = atof(argv[++i]);
+    } else {
+      usage();
+    }
+  }
+
+  if (iterations == 0) usage();
+
+  void *scanner = tree_sitter_hack_external_scanner_create();
+
+  for (unsigned f = 0; f < FIXTURE_COUNT; f++) {
+    if (fixtures[f].input == NULL) fixtures[f].input = large_body();
+  }
+
+  static char names[MAX_METRICS][64];
+  Metric metrics[MAX_METRICS];
+  unsigned count = 0;
+
+  char long_state[TREE_SITTER_SERIALIZATION_BUFFER_SIZE] = {0};
+  unsigned long_length = 3 + STRING_CAP;
+  memset(&long_state[3], 'X', STRING_CAP);
+
+  metrics[count++] = (Metric){"restore empty ns", time_restore(scanner, NULL, 0, iterations)};
+  metrics[count++] = (Metric){"restore short ns", time_restore(scanner, "\0\1\0SQL", 6, iterations)};
+  metrics[count++] =
+      (Metric){"restore long ns", time_restore(scanner, long_state, long_length, iterations)};
+
+  // Restoring an empty state right after the longest possible delimiter has to cost the same as
+  // restoring it when no heredoc has been seen.
+  tree_sitter_hack_external_scanner_deserialize(scanner, long_state, long_length);
+  metrics[count++] =
+      (Metric){"restore empty after long ns", time_restore(scanner, NULL, 0, iterations)};
+
+  for (unsigned i = 0; i < count; i++) {
+    printf("%-32s %10.1f\n", metrics[i].name, metrics[i].value);
+  }
+
+  // Scanning walks the whole fixture at most, so fewer iterations are enough.
+  unsigned long scan_iterations = iterations / 10 > 0 ? iterations / 10 : 1;
+
+  printf("\n%-32s %10s  %s\n", "scan", "ns/op", "result");
+
+  for (unsigned f = 0; f < FIXTURE_COUNT; f++) {
+    // State 0 has no valid external tokens so the scanner is never called with it.
+    for (unsigned state = 1; state < STATE_COUNT_EXTERNAL; state++) {
+      TSSymbol result;
+      double elapsed = time_scan(
+          scanner, &fixtures[f], ts_external_scanner_states[state], scan_iterations, &result);
+
+      char *name = names[count];
+      snprintf(name, sizeof(names[count]), "scan %s state %u ns", fixtures[f].name, state);
+      metrics[count++] = (Metric){name, elapsed};
+
+      printf(
+          "%-32s %10.1f  %s\n",
+          name,
+          elapsed,
+          result < EXTERNAL_TOKEN_COUNT ? TokenTypes[result] : "-");
+    }
+  }
+
+  tree_sitter_hack_external_scanner_destroy(scanner);
+
+  return finish_baseline(baseline, save, metrics, count, threshold);
+}
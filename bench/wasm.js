@@ -0,0 +1,104 @@
+/**
+ * Size and startup cost of tree-sitter-hack.wasm in web-tree-sitter, see bin/wasm-report:
+ *
+ *     $ node bench/wasm.js --wasm tree-sitter-hack.wasm --save tmp/wasm-report.new
+ *
+ * "load ms" is what a page pays before its first parse: compiling, instantiating and linking the
+ * module with Language.load. "compile ms" is the compile step on its own. Times are the fastest of
+ * --iterations runs. Saved reports use the same format as the baselines in bench/baseline.h.
+ */
+
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+const { performance } = require('perf_hooks');
+const Parser = require('web-tree-sitter');
+
+function usage() {
+  console.error('usage: wasm.js [--wasm FILE] [--iterations N] [--save FILE]');
+  process.exit(1);
+}
+
+function options() {
+  const options = { wasm: 'tree-sitter-hack.wasm', iterations: 5, save: null };
+  const args = process.argv.slice(2);
+
+  for (let i = 0; i < args.length; i += 2) {
+    if (i + 1 >= args.length) usage();
+    const value = args[i + 1];
+
+    if (args[i] === '--wasm') {
+      options.wasm = value;
+    } else if (args[i] === '--iterations') {
+      options.iterations = parseInt(value, 10);
+    } else if (args[i] === '--save') {
+      options.save = value;
+    } else {
+      usage();
+    }
+  }
+
+  if (!(options.iterations > 0)) usage();
+  return options;
+}
+
+async function fastest(iterations, run) {
+  let best = Infinity;
+  for (let i = 0; i < iterations; i++) {
+    const start = performance.now();
+    await run();
+    best = Math.min(best, performance.now() - start);
+  }
+  return best;
+}
+
+function corpus(dir) {
+  return fs.readdirSync(dir, { withFileTypes: true }).flatMap(entry => {
+    const file = path.join(dir, entry.name);
+    if (entry.isDirectory()) return corpus(file);
+    return /\.(hack|php)$/.test(entry.name) ? [fs.readFileSync(file, 'utf8')] : [];
+  });
+}
+
+async function main() {
+  const { wasm, iterations, save } = options();
+  const bytes = fs.readFileSync(wasm);
+
+  await Parser.init();
+  const compileMs = await fastest(iterations, () => WebAssembly.compile(bytes));
+  let language;
+  const loadMs = await fastest(iterations, async () => {
+    language = await Parser.Language.load(bytes);
+  });
+
+  const parser = new Parser();
+  parser.setLanguage(language);
+  const sources = corpus('test/cases');
+  const parseMs = await fastest(iterations, () => {
+    for (const source of sources) parser.parse(source).delete();
+  });
+
+  const metrics = [
+    ['wasm bytes', bytes.length],
+    ['wasm gzip bytes', zlib.gzipSync(bytes, { level: 9 }).length],
+    ['compile ms', compileMs],
+    ['load ms', loadMs],
+    ['corpus parse ms', parseMs],
+  ];
+
+  for (const [name, value] of metrics) {
+    console.log(`${name.padEnd(16)} ${Number.isInteger(value) ? value : value.toFixed(2)}`);
+  }
+
+  if (save) {
+    fs.writeFileSync(
+      save,
+      metrics.map(([name, value]) => `${name}\t${value.toFixed(6)}\n`).join(''),
+    );
+  }
+}
+
+main().catch(error => {
+  console.error(error);
+  process.exit(1);
+});
@@ -0,0 +1,162 @@
+/**
+ * XHP body lexing benchmark. Times the generated ts_lex in the lex state Tree-sitter uses between
+ * XHP tags, where it produces xhp_string and xhp_comment tokens, over a few generated templates
+ * with a mock lexer so no Tree-sitter runtime is needed.
+ *
+ *     $ bin/benchmark-xhp --save tmp/bench-xhp-baseline
+ *     $ bin/benchmark-xhp --baseline tmp/bench-xhp-baseline
+ *
+ * Tags and braced expressions are lexed in other states by the real parser. The benchmark only
+ * skips over them, so the numbers are for body text and comments only.
+ */
+
+// Pull in the generated ts_lex.
+#include "../src/parser.c"
+
+#include "baseline.h"
+#include "mock_lexer.h"
+
+typedef struct {
+  const char *name;
+  const char *line;
+} Fixture;
+
+// Each fixture is a line repeated to fill a large template.
+static Fixture fixtures[] = {
+    {"text",
+     "      Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor "
+     "incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud.\n"},
+    {"markup",
+     "      <li class=\"item\"><a href={$url}>Item</a> <span>{$count}</span> more</li>\n"},
+    {"comments", "      <!-- Shown to everyone, see the experiment config -->\n      text\n"},
+};
+
+#define FIXTURE_COUNT (sizeof(fixtures) / sizeof(fixtures[0]))
+#define LINES 1024
+
+// Jump past the tag or braced expression at position, which the parser lexes in other states.
+static uint32_t skip_markup(const char *source, uint32_t length, uint32_t position) {
+  char close = source[position] == '{' ? '}' : '>';
+  while (position < length && source[position] != close) position++;
+  return position < length ? position + 1 : length;
+}
+
+// Whether the parse table has an action for symbol in state.
+static bool has_action(TSStateId state, TSSymbol symbol) {
+  if (state < LARGE_STATE_COUNT) return ts_parse_table[state][symbol] != 0;
+
+  const uint16_t *data = &ts_small_parse_table[ts_small_parse_table_map[SMALL_STATE(state)]];
+  uint16_t group_count = *data++;
+  for (unsigned i = 0; i < group_count; i++) {
+    data++;
+    uint16_t symbol_count = *data++;
+    for (unsigned j = 0; j < symbol_count; j++) {
+      if (*data++ == symbol) return true;
+    }
+  }
+  return false;
+}
+
+// The ts_lex state between XHP tags, where xhp_string and xhp_comment are lexed. It's looked up
+// rather than hard-coded, since its number changes whenever src/parser.c is regenerated.
+static uint16_t body_lex_state() {
+  for (TSStateId state = 1; state < STATE_COUNT; state++) {
+    if (has_action(state, sym_xhp_string)) return ts_lex_modes[state].lex_state;
+  }
+
+  fprintf(stderr, "No parse state accepts xhp_string\n");
+  exit(1);
+}
+
+static volatile unsigned sink;
+
+// Lex the whole template, returning the number of body tokens.
+static unsigned lex_template(MockLexer *lexer, uint16_t lex_state) {
+  unsigned tokens = 0;
+  uint32_t position = 0;
+
+  while (position < lexer->length) {
+    mock_reset(lexer, lexer->input, lexer->length, position);
+    bool found = ts_lex(&lexer->base, lex_state);
+    TSSymbol symbol = lexer->base.result_symbol;
+
+    if (found && (symbol == sym_xhp_string || symbol == sym_xhp_comment)) {
+      tokens++;
+      position = lexer->token_end;
+    } else {
+      position = skip_markup(lexer->input, lexer->length, lexer->token_start);
+    }
+  }
+
+  sink += tokens;
+  return tokens;
+}
+
+static void usage() {
+  fprintf(
+      stderr,
+      "usage: xhp [--iterations N] [--baseline FILE] [--save FILE] [--threshold PERCENT]\n");
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  unsigned iterations = 50;
+  const char *baseline = NULL;
+  const char *save = NULL;
+  double threshold = 10;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) usage();
+
+    if (strcmp(argv[i], "--iterations") == 0) {
+      iterations = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--baseline") == 0) {
+      baseline = argv[++i];
+    } else if (strcmp(argv[i], "--save") == 0) {
+      save = argv[++i];
+    } else if (strcmp(argv[i], "--threshold") == 0) {
+      threshold = atof(argv[++i]);
+    } else {
+      usage();
+    }
+  }
+
+  if (iterations == 0) usage();
+
+  uint16_t lex_state = body_lex_state();
+
+  Metric metrics[FIXTURE_COUNT * 2];
+  static char names[FIXTURE_COUNT * 2][64];
+  unsigned count = 0;
+
+  printf("%-16s %12s %12s %12s\n", "fixture", "bytes", "tokens", "ns/KB");
+
+  for (unsigned i = 0; i < FIXTURE_COUNT; i++) {
+    MockLexer lexer;
+    mock_lexer_init(&lexer);
+    lexer.input = repeat_line(fixtures[i].line, LINES, "", &lexer.length);
+
+    unsigned tokens = 0;
+    double fastest = 0;
+    for (unsigned iteration = 0; iteration < iterations; iteration++) {
+      double start = now_ns();
+      tokens = lex_template(&lexer, lex_state);
+      double elapsed = now_ns() - start;
+      if (iteration == 0 || elapsed < fastest) fastest = elapsed;
+    }
+
+    double ns_per_kb = fastest * 1024 / lexer.length;
+    printf("%-16s %12u %12u %12.0f\n", fixtures[i].name, lexer.length, tokens, ns_per_kb);
+
+    snprintf(names[count], sizeof(names[count]), "%s tokens", fixtures[i].name);
+    metrics[count] = (Metric){names[count], tokens, false, true};
+    count++;
+    snprintf(names[count], sizeof(names[count]), "%s ns/KB", fixtures[i].name);
+    metrics[count] = (Metric){names[count], ns_per_kb, false, false};
+    count++;
+
+    free((char *)lexer.input);
+  }
+
+  return finish_baseline(baseline, save, metrics, count, threshold);
+}
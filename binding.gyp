@@ -1,4 +1,18 @@
 {
+  "variables": {
+    # Count external scanner and lexer work: node-gyp rebuild --instrument=true
+    "instrument%": "false",
+    # Production build with LTO and no PLT: node-gyp rebuild --optimize=true. Add PGO with a clang
+    # profile from bin/benchmark-build: CC=clang CXX=clang++ node-gyp rebuild --optimize=true
+    # --pgo_profile=$PWD/tmp/hack.profdata
+    "optimize%": "false",
+    "pgo_profile%": "",
+    # Build the optional parseFiles addon: bin/build-parse-files, or node-gyp rebuild
+    # --parse_files=true --tree_sitter_lib=PATH with PATH the lib directory of a Tree-sitter v0.20.6
+    # checkout. It links that runtime, the grammar addon never does.
+    "parse_files%": "false",
+    "tree_sitter_lib%": "tmp/tree-sitter/lib"
+  },
   "targets": [
     {
       "target_name": "tree_sitter_hack_binding",
@@ -7,10 +21,40 @@
         "src"
       ],
       "sources": [
-        "src/parser.c",
         "bindings/node/binding.cc",
         "src/scanner.c"
       ],
+      "conditions": [
+        ["instrument=='true'", {
+          # instrument.c includes parser.c, see src/instrument.h.
+          "sources": ["src/instrument.c"],
+          "defines": ["TREE_SITTER_HACK_INSTRUMENT"]
+        }, {
+          "sources": ["src/parser.c"]
+        }],
+        ["optimize=='true'", {
+          "cflags": ["-O3", "-fno-plt", "-flto"],
+          "ldflags": ["-flto"],
+          "xcode_settings": {
+            "GCC_OPTIMIZATION_LEVEL": "3",
+            "LLVM_LTO": "YES"
+          }
+        }],
+        ["optimize=='true' and pgo_profile!=''", {
+          "cflags": [
+            "-fprofile-instr-use=<(pgo_profile)",
+            "-Wno-profile-instr-unprofiled",
+            "-Wno-profile-instr-out-of-date"
+          ],
+          "xcode_settings": {
+            "OTHER_CFLAGS": [
+              "-fprofile-instr-use=<(pgo_profile)",
+              "-Wno-profile-instr-unprofiled",
+              "-Wno-profile-instr-out-of-date"
+            ]
+          }
+        }]
+      ],
       "cflags_c": [
         "-std=c99",
         "-Wno-trigraphs"
@@ -22,5 +66,37 @@
         ]
       }
     }
+  ],
+  "conditions": [
+    ["parse_files=='true'", {
+      "targets": [
+        {
+          "target_name": "tree_sitter_hack_parse_files",
+          "include_dirs": [
+            "<!(node -e \"require('nan')\")",
+            "<(tree_sitter_lib)/include",
+            "<(tree_sitter_lib)/src"
+          ],
+          "sources": [
+            "bindings/node/file_input.cc",
+            "bindings/node/parse_files.cc",
+            "<(tree_sitter_lib)/src/lib.c"
+          ],
+          "conditions": [
+            ["optimize=='true'", {
+              "cflags": ["-O3", "-flto"],
+              "ldflags": ["-flto"],
+              "xcode_settings": {
+                "GCC_OPTIMIZATION_LEVEL": "3",
+                "LLVM_LTO": "YES"
+              }
+            }]
+          ],
+          "cflags_c": [
+            "-std=c99"
+          ]
+        }
+      ]
+    }]
   ]
 }
@@ -2,6 +2,10 @@
 #include <node.h>
 #include "nan.h"
 
+#ifdef TREE_SITTER_HACK_INSTRUMENT
+#include "instrument.h"
+#endif
+
 using namespace v8;
 
 extern "C" TSLanguage * tree_sitter_hack();
@@ -10,6 +14,61 @@ namespace {
 
 NAN_METHOD(New) {}
 
+#ifdef TREE_SITTER_HACK_INSTRUMENT
+void SetNumber(Local<Object> object, const char *key, uint64_t value) {
+  Nan::Set(object, Nan::New(key).ToLocalChecked(), Nan::New<Number>(static_cast<double>(value)));
+}
+
+Local<Object> ScanCounters(const TreeSitterHackScanCounters &counters) {
+  Local<Object> result = Nan::New<Object>();
+  SetNumber(result, "calls", counters.calls);
+  SetNumber(result, "advances", counters.advances);
+  SetNumber(result, "failures", counters.failures);
+  return result;
+}
+
+Local<Array> LexStates(bool keywords) {
+  uint32_t count;
+  const uint64_t *states = tree_sitter_hack_instrument_lex_states(keywords, &count);
+  Local<Array> result = Nan::New<Array>(count);
+  for (uint32_t i = 0; i < count; i++) {
+    Nan::Set(result, i, Nan::New<Number>(static_cast<double>(states[i])));
+  }
+  return result;
+}
+
+// Counters from the instrumentation build, see src/instrument.h.
+NAN_METHOD(InstrumentStats) {
+  TreeSitterHackStats stats;
+  tree_sitter_hack_instrument_stats(&stats);
+
+  Local<Object> result = Nan::New<Object>();
+  SetNumber(result, "scans", stats.scans);
+  SetNumber(result, "rollbacks", stats.rollbacks);
+  SetNumber(result, "rollbackAdvances", stats.rollback_advances);
+  Nan::Set(
+      result,
+      Nan::New("scanStart").ToLocalChecked(),
+      ScanCounters(stats.functions[TREE_SITTER_HACK_SCAN_START]));
+  Nan::Set(
+      result,
+      Nan::New("scanBody").ToLocalChecked(),
+      ScanCounters(stats.functions[TREE_SITTER_HACK_SCAN_BODY]));
+  Nan::Set(
+      result,
+      Nan::New("scanDelimiter").ToLocalChecked(),
+      ScanCounters(stats.functions[TREE_SITTER_HACK_SCAN_DELIMITER]));
+  SetNumber(result, "lexCalls", stats.lex_calls);
+  SetNumber(result, "keywordLexCalls", stats.keyword_lex_calls);
+  Nan::Set(result, Nan::New("lexStates").ToLocalChecked(), LexStates(false));
+  Nan::Set(result, Nan::New("keywordLexStates").ToLocalChecked(), LexStates(true));
+
+  info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(ResetInstrumentStats) { tree_sitter_hack_instrument_reset(); }
+#endif
+
 void Init(Local<Object> exports, Local<Object> module) {
   Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
   tpl->SetClassName(Nan::New("Language").ToLocalChecked());
@@ -20,6 +79,11 @@ void Init(Local<Object> exports, Local<Object> module) {
   Nan::SetInternalFieldPointer(instance, 0, tree_sitter_hack());
 
   Nan::Set(instance, Nan::New("name").ToLocalChecked(), Nan::New("hack").ToLocalChecked());
+
+#ifdef TREE_SITTER_HACK_INSTRUMENT
+  Nan::SetMethod(instance, "instrumentStats", InstrumentStats);
+  Nan::SetMethod(instance, "resetInstrumentStats", ResetInstrumentStats);
+#endif
   Nan::Set(module, Nan::New("exports").ToLocalChecked(), instance);
 }
 
@@ -0,0 +1,135 @@
+#include "file_input.h"
+
+#include <cerrno>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t kChunkSize = 64 * 1024;
+
+}  // namespace
+
+FileInput::~FileInput() {
+#ifndef _WIN32
+  if (mapped_) munmap(const_cast<char *>(data_), length_);
+  if (fd_ >= 0) close(fd_);
+#endif
+}
+
+#ifdef _WIN32
+bool FileInput::Open(const std::string &path, uint64_t mmap_limit) {
+  (void)mmap_limit;
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == nullptr) return false;
+
+  char chunk[kChunkSize];
+  size_t length;
+  while ((length = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    buffer_.insert(buffer_.end(), chunk, chunk + length);
+  }
+
+  bool ok = !ferror(file) && buffer_.size() <= UINT32_MAX;
+  fclose(file);
+  if (!ok) return false;
+
+  length_ = buffer_.size();
+  data_ = buffer_.data();
+  return true;
+}
+#else
+bool FileInput::Open(const std::string &path, uint64_t mmap_limit) {
+  fd_ = open(path.c_str(), O_RDONLY);
+  if (fd_ < 0) return false;
+
+  struct stat info;
+  if (fstat(fd_, &info) != 0) return false;
+
+  // A directory opens fine but fails every read, and a pipe's size isn't its length.
+  if (!S_ISREG(info.st_mode)) {
+    errno = S_ISDIR(info.st_mode) ? EISDIR : EINVAL;
+    return false;
+  }
+
+  // Tree-sitter can't address past 4GB.
+  if ((uint64_t)info.st_size > UINT32_MAX) {
+    errno = EFBIG;
+    return false;
+  }
+  length_ = info.st_size;
+
+  // Mapping an empty file fails.
+  if (length_ == 0 || length_ > mmap_limit) return true;
+
+  void *data = mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (data == MAP_FAILED) return true;  // Fall back to streaming.
+
+  posix_madvise(data, length_, POSIX_MADV_SEQUENTIAL);
+  data_ = static_cast<const char *>(data);
+  mapped_ = true;
+  return true;
+}
+#endif
+
+TSInput FileInput::Input() { return {this, Read, TSInputEncodingUTF8}; }
+
+const char *FileInput::Read(void *payload, uint32_t byte, TSPoint position, uint32_t *bytes_read) {
+  FileInput *input = static_cast<FileInput *>(payload);
+
+  if (byte >= input->length_ || input->error_ != 0) {
+    *bytes_read = 0;
+    return "";
+  }
+
+  if (input->data_ != nullptr) {
+    *bytes_read = input->length_ - byte;
+    return input->data_ + byte;
+  }
+
+#ifdef _WIN32
+  *bytes_read = 0;
+  return "";
+#else
+  // The chunk stays valid until the next call, which is all Tree-sitter needs.
+  input->buffer_.resize(kChunkSize);
+  ssize_t length;
+  do {
+    length = pread(input->fd_, input->buffer_.data(), kChunkSize, byte);
+  } while (length < 0 && errno == EINTR);
+
+  if (length < 0) {
+    input->error_ = errno;
+    *bytes_read = 0;
+    return "";
+  }
+
+  *bytes_read = length;
+  return input->buffer_.data();
+#endif
+}
+
+std::string FileInput::Text(uint32_t start, uint32_t end) {
+  if (end > length_) end = length_;
+  if (start >= end) return std::string();
+  if (data_ != nullptr) return std::string(data_ + start, end - start);
+
+  std::string text(end - start, '\0');
+#ifndef _WIN32
+  size_t offset = 0;
+  while (offset < text.size()) {
+    ssize_t length = pread(fd_, &text[offset], text.size() - offset, start + offset);
+    if (length < 0 && errno == EINTR) continue;
+    if (length < 0 && error_ == 0) error_ = errno;
+    if (length <= 0) break;
+    offset += length;
+  }
+  text.resize(offset);
+#endif
+  return text;
+}
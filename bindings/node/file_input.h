@@ -0,0 +1,45 @@
+#ifndef TREE_SITTER_HACK_FILE_INPUT_H_
+#define TREE_SITTER_HACK_FILE_INPUT_H_
+
+#include <tree_sitter/api.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Feeds a file to Tree-sitter without copying it into a string first. Files up to mmap_limit bytes
+// are memory mapped and the read callback returns slices of the mapping. Larger files are streamed
+// with pread in fixed size chunks. Windows builds read the whole file instead.
+class FileInput {
+ public:
+  FileInput() = default;
+  FileInput(const FileInput &) = delete;
+  FileInput &operator=(const FileInput &) = delete;
+  ~FileInput();
+
+  // Returns false and leaves the reason in errno if the file can't be opened or isn't a regular
+  // file.
+  bool Open(const std::string &path, uint64_t mmap_limit);
+
+  TSInput Input();
+
+  // Source text between two byte offsets, for node text.
+  std::string Text(uint32_t start, uint32_t end);
+
+  // The errno of the first failed read while streaming, or 0. Tree-sitter takes the empty chunk
+  // returned after a failure as the end of the file, so a tree parsed with an error is truncated.
+  int Error() const { return error_; }
+
+ private:
+  static const char *Read(void *payload, uint32_t byte, TSPoint position, uint32_t *bytes_read);
+
+  int fd_ = -1;
+  uint32_t length_ = 0;
+  // The mapping, or the whole file on Windows. Null when streaming.
+  const char *data_ = nullptr;
+  bool mapped_ = false;
+  int error_ = 0;
+  std::vector<char> buffer_;
+};
+
+#endif  // TREE_SITTER_HACK_FILE_INPUT_H_
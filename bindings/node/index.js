@@ -17,3 +17,128 @@ try {
 try {
   module.exports.nodeTypeInfo = require("../../src/node-types.json");
 } catch (_) {}
+
+// parseFiles and checkFiles run in a separate addon with its own Tree-sitter runtime, which is only
+// built on request, see binding.gyp. It's loaded the first time they're called.
+let batches = null;
+
+function loadBatches() {
+  if (batches !== null) return batches;
+
+  for (const build of ['Release', 'Debug']) {
+    try {
+      batches = require(`../../build/${build}/tree_sitter_hack_parse_files`);
+    } catch (error) {
+      if (error.code !== 'MODULE_NOT_FOUND') throw error;
+      continue;
+    }
+    batches.setLanguage(module.exports);
+    return batches;
+  }
+
+  throw new Error(
+    'parseFiles and checkFiles need the parseFiles addon. Build it with bin/build-parse-files, ' +
+      'or node-gyp rebuild --parse_files=true --tree_sitter_lib=PATH',
+  );
+}
+
+/**
+ * Parse files on the libuv thread pool and resolve with their syntax errors and top-level
+ * declarations, without creating a JS object per tree node:
+ *
+ *     const hack = require('tree-sitter-hacklang');
+ *     const results = await hack.parseFiles(['src/Foo.hack'], { threads: 4 });
+ *     // [{path, errors: [{type, isMissing, startIndex, endIndex, startPosition, endPosition}],
+ *     //   declarations: [{type, name, startIndex, endIndex, startPosition, endPosition}]}]
+ *
+ * Files that can't be read have an `error` message instead. `threads` defaults to the number of
+ * CPUs. Raise UV_THREADPOOL_SIZE to use more than 4.
+ *
+ * This needs the optional parseFiles addon, see binding.gyp. Without it the promise rejects.
+ *
+ * Files are memory mapped and parsed straight from the mapping without being copied. Files larger
+ * than `mmapLimit` bytes (default 256MB) are streamed in chunks instead.
+ *
+ * With `timeoutMicros`, parsing a file gives up after that long and its result has `timedOut: true`
+ * and no errors or declarations, so one pathological file can't stall a worker. Aborting `signal`
+ * (an AbortSignal) stops the whole batch, including a file that's halfway parsed, and rejects.
+ *
+ * With `tree: true`, every parsed file also has `tree`, a Buffer holding the whole tree as a flat
+ * preorder array of nodes, for handing to workers that don't load the parser. The format is
+ * documented in bindings/rust/serialize.rs, which can read it back. It stores field ids in a byte,
+ * so the promise rejects if the language has more than 255 fields.
+ */
+module.exports.parseFiles = (
+  paths,
+  { threads = 0, mmapLimit = 0, timeoutMicros = 0, tree = false, signal } = {},
+) =>
+  startBatch(paths, threads, mmapLimit, timeoutMicros, tree, false, signal);
+
+/**
+ * Check whether files are syntactically valid, for pre-commit hooks and CI gates that only need a
+ * yes or no:
+ *
+ *     const results = await hack.checkFiles(['src/Foo.hack'], { threads: 4 });
+ *     // [{path, valid, error?: {type, isMissing, startIndex, endIndex, startPosition, endPosition}}]
+ *
+ * `error` is the first syntax error in the file. This does less than parseFiles: a valid file is
+ * known to be valid from its root node alone, the search for errors stops at the first one, and no
+ * declarations are collected. Files that time out or can't be read aren't valid, and have
+ * `timedOut: true` or a `message` instead of `error`. Takes the same options as parseFiles except
+ * `tree`.
+ */
+module.exports.checkFiles = async (
+  paths,
+  { threads = 0, mmapLimit = 0, timeoutMicros = 0, signal } = {},
+) => {
+  const results = await startBatch(
+    paths,
+    threads,
+    mmapLimit,
+    timeoutMicros,
+    false,
+    true,
+    signal,
+  );
+
+  return results.map(({ path, errors, timedOut, error }) => {
+    if (error !== undefined) return { path, valid: false, message: error };
+    if (timedOut) return { path, valid: false, timedOut: true };
+    if (errors.length > 0) return { path, valid: false, error: errors[0] };
+    return { path, valid: true };
+  });
+};
+
+function startBatch(
+  paths,
+  threads,
+  mmapLimit,
+  timeoutMicros,
+  tree,
+  check,
+  signal,
+) {
+  return new Promise((resolve, reject) => {
+    if (signal && signal.aborted) {
+      reject(new Error('Parsing was cancelled'));
+      return;
+    }
+
+    const { parseFiles, cancelParseFiles } = loadBatches();
+    const cancel = () => cancelParseFiles(batch);
+    const batch = parseFiles(
+      paths,
+      threads,
+      mmapLimit,
+      timeoutMicros,
+      tree,
+      check,
+      (error, results) => {
+        if (signal) signal.removeEventListener('abort', cancel);
+        error ? reject(error) : resolve(results);
+      },
+    );
+
+    if (signal) signal.addEventListener('abort', cancel);
+  });
+}
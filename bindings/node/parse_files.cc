@@ -0,0 +1,562 @@
+#include <node.h>
+#include <tree_sitter/api.h>
+
+#include "file_input.h"
+#include "nan.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace v8;
+
+/**
+ * The optional tree_sitter_hack_parse_files addon, see binding.gyp. It links its own Tree-sitter
+ * runtime and is handed the language of the grammar addon with setLanguage(language), so building
+ * the grammar never needs the runtime or node-tree-sitter.
+ *
+ * parseFiles(paths, threads, mmapLimit, timeoutMicros, tree, check, callback) parses files on the
+ * libuv thread pool and hands back syntax errors and top-level declarations as plain objects, so
+ * callers that only need those don't create a JS wrapper per visited node. With check, only the
+ * first syntax error of each file is found and declarations are skipped. It returns a batch id for
+ * cancelParseFiles(id). See parseFiles and checkFiles in index.js for the public API.
+ *
+ * Like tools/ts-errors.c, every worker owns a parser and claims the next unparsed file from a
+ * shared index. Parsers are checked out of a process-wide pool and returned reset, so calling
+ * parseFiles once per request doesn't create a parser and external scanner per worker per call.
+ * Workers only run in parallel up to UV_THREADPOOL_SIZE (4 by default). Files are read through
+ * FileInput so they're never copied into a string.
+ */
+
+namespace {
+
+// Larger files are streamed instead of memory mapped.
+const uint64_t kDefaultMmapLimit = 256 << 20;
+
+// From setLanguage, before the first batch.
+const TSLanguage *language = nullptr;
+
+struct Range {
+  uint32_t start_byte;
+  uint32_t end_byte;
+  TSPoint start_point;
+  TSPoint end_point;
+};
+
+struct SyntaxError {
+  const char *type;
+  bool is_missing;
+  Range range;
+};
+
+struct Declaration {
+  const char *type;
+  std::string name;
+  Range range;
+};
+
+struct FileResult {
+  std::string path;
+  // Why the file couldn't be read, empty if it was parsed.
+  std::string error;
+  // Parsing took longer than the batch's timeout.
+  bool timed_out = false;
+  std::vector<SyntaxError> errors;
+  std::vector<Declaration> declarations;
+  // The whole tree in the format of bindings/rust/serialize.rs, if the batch asked for it.
+  std::vector<uint8_t> tree;
+};
+
+struct Batch {
+  std::vector<FileResult> files;
+  uint64_t mmap_limit;
+  uint64_t timeout_micros;
+  bool serialize_tree;
+  // Stop at the first syntax error and skip declarations, for checkFiles.
+  bool check_only;
+  std::atomic<size_t> next_file{0};
+  // Tree-sitter's cancellation flag, set by cancelParseFiles.
+  std::atomic<size_t> cancelled{0};
+  // Only touched on the main thread.
+  uint32_t id;
+  unsigned running_workers = 0;
+  Nan::Callback callback;
+};
+
+static_assert(
+    sizeof(std::atomic<size_t>) == sizeof(size_t),
+    "ts_parser_set_cancellation_flag reads the flag as a size_t");
+
+// Batches that are still running, by id. Only touched on the main thread.
+std::unordered_map<uint32_t, std::weak_ptr<Batch>> running_batches;
+uint32_t next_batch_id = 1;
+
+// Parsers that aren't running a batch. Workers run on the libuv thread pool, so there are never
+// more parsers than UV_THREADPOOL_SIZE and the pool doesn't need a cap.
+std::mutex idle_parsers_mutex;
+std::vector<TSParser *> idle_parsers;
+
+TSParser *CheckOutParser() {
+  {
+    std::lock_guard<std::mutex> lock(idle_parsers_mutex);
+    if (!idle_parsers.empty()) {
+      TSParser *parser = idle_parsers.back();
+      idle_parsers.pop_back();
+      return parser;
+    }
+  }
+
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, language);
+  return parser;
+}
+
+// Resetting deserializes the external scanner from an empty state, so the next batch reuses the
+// scanner instead of creating one. The cancellation flag belongs to the finished batch.
+void ReturnParser(TSParser *parser) {
+  ts_parser_reset(parser);
+  ts_parser_set_timeout_micros(parser, 0);
+  ts_parser_set_cancellation_flag(parser, nullptr);
+
+  std::lock_guard<std::mutex> lock(idle_parsers_mutex);
+  idle_parsers.push_back(parser);
+}
+
+struct Symbols {
+  TSFieldId name;
+  TSFieldId body;
+  TSSymbol namespace_declaration;
+  TSSymbol alias_declaration;
+  TSSymbol const_declaration;
+  TSSymbol identifier;
+  std::vector<TSSymbol> declarations;
+
+  TSSymbol Named(const char *name) {
+    return ts_language_symbol_for_name(language, name, strlen(name), true);
+  }
+
+  Symbols() {
+    name = ts_language_field_id_for_name(language, "name", strlen("name"));
+    body = ts_language_field_id_for_name(language, "body", strlen("body"));
+    namespace_declaration = Named("namespace_declaration");
+    alias_declaration = Named("alias_declaration");
+    const_declaration = Named("const_declaration");
+    identifier = Named("identifier");
+
+    for (const char *type : {
+             "alias_declaration",
+             "class_declaration",
+             "const_declaration",
+             "enum_class_declaration",
+             "enum_declaration",
+             "function_declaration",
+             "interface_declaration",
+             "namespace_declaration",
+             "trait_declaration",
+         }) {
+      declarations.push_back(Named(type));
+    }
+  }
+
+  bool IsDeclaration(TSSymbol symbol) const {
+    for (TSSymbol declaration : declarations) {
+      if (symbol == declaration) return true;
+    }
+    return false;
+  }
+};
+
+const Symbols &GetSymbols() {
+  static const Symbols symbols;
+  return symbols;
+}
+
+Range NodeRange(TSNode node) {
+  return {
+      ts_node_start_byte(node),
+      ts_node_end_byte(node),
+      ts_node_start_point(node),
+      ts_node_end_point(node)};
+}
+
+std::string NodeText(TSNode node, FileInput *source) {
+  if (ts_node_is_null(node)) return std::string();
+  return source->Text(ts_node_start_byte(node), ts_node_end_byte(node));
+}
+
+// The first identifier child, for declarations without a name field.
+TSNode FirstIdentifier(TSNode node, const Symbols &symbols) {
+  uint32_t count = ts_node_named_child_count(node);
+  for (uint32_t i = 0; i < count; i++) {
+    TSNode child = ts_node_named_child(node, i);
+    if (ts_node_symbol(child) == symbols.identifier) return child;
+  }
+  return TSNode{};
+}
+
+void CollectDeclaration(TSNode node, FileInput *source, FileResult *file);
+
+// Record the declarations among the direct children of parent.
+void CollectDeclarations(TSNode parent, FileInput *source, FileResult *file) {
+  TSTreeCursor cursor = ts_tree_cursor_new(parent);
+
+  if (ts_tree_cursor_goto_first_child(&cursor)) {
+    do {
+      TSNode node = ts_tree_cursor_current_node(&cursor);
+      if (ts_node_is_named(node)) CollectDeclaration(node, source, file);
+    } while (ts_tree_cursor_goto_next_sibling(&cursor));
+  }
+
+  ts_tree_cursor_delete(&cursor);
+}
+
+void CollectDeclaration(TSNode node, FileInput *source, FileResult *file) {
+  const Symbols &symbols = GetSymbols();
+  TSSymbol symbol = ts_node_symbol(node);
+  if (!symbols.IsDeclaration(symbol)) return;
+
+  const char *type = ts_node_type(node);
+
+  if (symbol == symbols.const_declaration) {
+    // const int A = 1, B = 2; declares each constant separately.
+    uint32_t count = ts_node_named_child_count(node);
+    for (uint32_t i = 0; i < count; i++) {
+      TSNode declarator = ts_node_named_child(node, i);
+      TSNode name = ts_node_child_by_field_id(declarator, symbols.name);
+      if (!ts_node_is_null(name)) {
+        file->declarations.push_back({type, NodeText(name, source), NodeRange(declarator)});
+      }
+    }
+    return;
+  }
+
+  TSNode name = symbol == symbols.alias_declaration ? FirstIdentifier(node, symbols)
+                                                    : ts_node_child_by_field_id(node, symbols.name);
+  file->declarations.push_back({type, NodeText(name, source), NodeRange(node)});
+
+  // Declarations in a braced namespace body are still top-level.
+  if (symbol == symbols.namespace_declaration) {
+    TSNode body = ts_node_child_by_field_id(node, symbols.body);
+    if (!ts_node_is_null(body)) CollectDeclarations(body, source, file);
+  }
+}
+
+// Walk the tree, only descending into subtrees that contain errors. With first_only, stop at the
+// first error, so a file with one error near the start only visits the nodes on the way to it.
+void CollectErrors(TSNode root, FileResult *file, bool first_only) {
+  TSTreeCursor cursor = ts_tree_cursor_new(root);
+
+  for (;;) {
+    TSNode node = ts_tree_cursor_current_node(&cursor);
+    bool is_missing = ts_node_is_missing(node);
+
+    if (is_missing || ts_node_symbol(node) == (TSSymbol)-1) {
+      file->errors.push_back({ts_node_type(node), is_missing, NodeRange(node)});
+      if (first_only) {
+        ts_tree_cursor_delete(&cursor);
+        return;
+      }
+    }
+
+    if (ts_node_has_error(node) && ts_tree_cursor_goto_first_child(&cursor)) continue;
+
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        return;
+      }
+    }
+  }
+}
+
+template <typename T>
+void Append(std::vector<uint8_t> *bytes, T value) {
+  for (size_t i = 0; i < sizeof(T); i++) bytes->push_back(static_cast<uint8_t>(value >> (i * 8)));
+}
+
+// Must match bindings/rust/serialize.rs, which documents the format.
+const uint8_t kTreeMagic[] = {'T', 'S', 'H', 'K'};
+const uint16_t kTreeVersion = 1;
+const uint8_t kTreeNamed = 1;
+const uint8_t kTreeMissing = 2;
+const uint8_t kTreeExtra = 4;
+
+void SerializeTree(const TSTree *tree, std::vector<uint8_t> *bytes) {
+  const TSLanguage *language = ts_tree_language(tree);
+  bytes->insert(bytes->end(), std::begin(kTreeMagic), std::end(kTreeMagic));
+  Append<uint16_t>(bytes, kTreeVersion);
+  Append<uint16_t>(bytes, ts_language_version(language));
+  Append<uint16_t>(bytes, ts_language_symbol_count(language));
+  Append<uint16_t>(bytes, ts_language_field_count(language));
+  // The node count is filled in at the end.
+  Append<uint32_t>(bytes, 0);
+
+  uint32_t count = 0;
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+
+  for (;;) {
+    TSNode node = ts_tree_cursor_current_node(&cursor);
+    uint8_t flags = (ts_node_is_named(node) ? kTreeNamed : 0) |
+                    (ts_node_is_missing(node) ? kTreeMissing : 0) |
+                    (ts_node_is_extra(node) ? kTreeExtra : 0);
+
+    Append<uint16_t>(bytes, ts_node_symbol(node));
+    Append<uint8_t>(bytes, ts_tree_cursor_current_field_id(&cursor));
+    Append<uint8_t>(bytes, flags);
+    Append<uint32_t>(bytes, ts_node_start_byte(node));
+    Append<uint32_t>(bytes, ts_node_end_byte(node));
+    Append<uint32_t>(bytes, ts_node_child_count(node));
+    count++;
+
+    if (ts_tree_cursor_goto_first_child(&cursor)) continue;
+
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        for (size_t i = 0; i < sizeof(count); i++) (*bytes)[12 + i] = count >> (i * 8);
+        return;
+      }
+    }
+  }
+}
+
+void ParseFile(TSParser *parser, FileResult *file, const Batch &batch) {
+  FileInput source;
+  if (!source.Open(file->path, batch.mmap_limit)) {
+    file->error = strerror(errno);
+    return;
+  }
+
+  TSTree *tree = ts_parser_parse(parser, nullptr, source.Input());
+  if (tree == nullptr) {
+    // Timed out or cancelled. Reset so the next file doesn't resume this parse.
+    ts_parser_reset(parser);
+    file->timed_out = true;
+    return;
+  }
+
+  TSNode root = ts_tree_root_node(tree);
+
+  if (ts_node_has_error(root)) CollectErrors(root, file, batch.check_only);
+  if (!batch.check_only) CollectDeclarations(root, &source, file);
+
+  // A read failed partway, so the tree is of a truncated file. Report it like a file that couldn't
+  // be opened, as bindings/rust/file.rs returns the read error.
+  if (source.Error() != 0) {
+    file->error = strerror(source.Error());
+    file->errors.clear();
+    file->declarations.clear();
+    ts_tree_delete(tree);
+    return;
+  }
+
+  if (batch.serialize_tree) SerializeTree(tree, &file->tree);
+
+  ts_tree_delete(tree);
+}
+
+Local<Object> Point(TSPoint point) {
+  Local<Object> result = Nan::New<Object>();
+  Nan::Set(result, Nan::New("row").ToLocalChecked(), Nan::New(point.row));
+  Nan::Set(result, Nan::New("column").ToLocalChecked(), Nan::New(point.column));
+  return result;
+}
+
+void SetRange(Local<Object> object, const Range &range) {
+  Nan::Set(object, Nan::New("startIndex").ToLocalChecked(), Nan::New(range.start_byte));
+  Nan::Set(object, Nan::New("endIndex").ToLocalChecked(), Nan::New(range.end_byte));
+  Nan::Set(object, Nan::New("startPosition").ToLocalChecked(), Point(range.start_point));
+  Nan::Set(object, Nan::New("endPosition").ToLocalChecked(), Point(range.end_point));
+}
+
+Local<Object> FileObject(const FileResult &file) {
+  Local<Object> result = Nan::New<Object>();
+  Nan::Set(result, Nan::New("path").ToLocalChecked(), Nan::New(file.path).ToLocalChecked());
+
+  if (!file.error.empty()) {
+    Nan::Set(result, Nan::New("error").ToLocalChecked(), Nan::New(file.error).ToLocalChecked());
+  }
+  if (file.timed_out) Nan::Set(result, Nan::New("timedOut").ToLocalChecked(), Nan::True());
+
+  Local<Array> errors = Nan::New<Array>(file.errors.size());
+  for (size_t i = 0; i < file.errors.size(); i++) {
+    const SyntaxError &error = file.errors[i];
+    Local<Object> object = Nan::New<Object>();
+    Nan::Set(object, Nan::New("type").ToLocalChecked(), Nan::New(error.type).ToLocalChecked());
+    Nan::Set(object, Nan::New("isMissing").ToLocalChecked(), Nan::New(error.is_missing));
+    SetRange(object, error.range);
+    Nan::Set(errors, i, object);
+  }
+  Nan::Set(result, Nan::New("errors").ToLocalChecked(), errors);
+
+  Local<Array> declarations = Nan::New<Array>(file.declarations.size());
+  for (size_t i = 0; i < file.declarations.size(); i++) {
+    const Declaration &declaration = file.declarations[i];
+    Local<Object> object = Nan::New<Object>();
+    Nan::Set(
+        object, Nan::New("type").ToLocalChecked(), Nan::New(declaration.type).ToLocalChecked());
+    Nan::Set(
+        object, Nan::New("name").ToLocalChecked(), Nan::New(declaration.name).ToLocalChecked());
+    SetRange(object, declaration.range);
+    Nan::Set(declarations, i, object);
+  }
+  Nan::Set(result, Nan::New("declarations").ToLocalChecked(), declarations);
+
+  if (!file.tree.empty()) {
+    Local<Object> tree =
+        Nan::CopyBuffer(reinterpret_cast<const char *>(file.tree.data()), file.tree.size())
+            .ToLocalChecked();
+    Nan::Set(result, Nan::New("tree").ToLocalChecked(), tree);
+  }
+
+  return result;
+}
+
+class ParseWorker : public Nan::AsyncWorker {
+ public:
+  explicit ParseWorker(std::shared_ptr<Batch> batch)
+      : Nan::AsyncWorker(nullptr, "tree-sitter-hack:parseFiles"), batch_(batch) {}
+
+  // Runs on the thread pool.
+  void Execute() override {
+    TSParser *parser = CheckOutParser();
+    ts_parser_set_timeout_micros(parser, batch_->timeout_micros);
+    ts_parser_set_cancellation_flag(
+        parser, reinterpret_cast<const size_t *>(&batch_->cancelled));
+
+    while (!batch_->cancelled.load(std::memory_order_relaxed)) {
+      size_t index = batch_->next_file.fetch_add(1, std::memory_order_relaxed);
+      if (index >= batch_->files.size()) break;
+      ParseFile(parser, &batch_->files[index], *batch_);
+    }
+
+    ReturnParser(parser);
+  }
+
+  // Runs on the main thread. The last worker to finish reports the whole batch.
+  void HandleOKCallback() override {
+    if (--batch_->running_workers > 0) return;
+
+    running_batches.erase(batch_->id);
+    Nan::HandleScope scope;
+
+    if (batch_->cancelled.load(std::memory_order_relaxed)) {
+      Local<Value> argv[] = {Nan::Error("Parsing was cancelled")};
+      batch_->callback.Call(1, argv, async_resource);
+      return;
+    }
+
+    Local<Array> results = Nan::New<Array>(batch_->files.size());
+    for (size_t i = 0; i < batch_->files.size(); i++) {
+      Nan::Set(results, i, FileObject(batch_->files[i]));
+    }
+
+    Local<Value> argv[] = {Nan::Null(), results};
+    batch_->callback.Call(2, argv, async_resource);
+  }
+
+ private:
+  std::shared_ptr<Batch> batch_;
+};
+
+// setLanguage(language) takes the Language object exported by the grammar addon, which holds the
+// TSLanguage pointer in its first internal field like node-tree-sitter expects.
+NAN_METHOD(SetLanguage) {
+  if (!info[0]->IsObject() || info[0].As<Object>()->InternalFieldCount() < 1) {
+    Nan::ThrowTypeError("Expected setLanguage(language)");
+    return;
+  }
+
+  auto pointer =
+      static_cast<const TSLanguage *>(Nan::GetInternalFieldPointer(info[0].As<Object>(), 0));
+  if (language != nullptr && language != pointer) {
+    Nan::ThrowError("parseFiles already has a different language");
+    return;
+  }
+  language = pointer;
+}
+
+NAN_METHOD(ParseFiles) {
+  if (language == nullptr) {
+    Nan::ThrowError("Call setLanguage(language) before parseFiles");
+    return;
+  }
+  if (info.Length() < 7 || !info[0]->IsArray() || !info[6]->IsFunction()) {
+    Nan::ThrowTypeError(
+        "Expected parseFiles(paths, threads, mmapLimit, timeoutMicros, tree, check, callback)");
+    return;
+  }
+  // SerializeTree stores field ids in a byte. Like bindings/rust/serialize.rs, refuse languages
+  // whose ids would be truncated rather than write trees the reader can't round-trip.
+  if (info[4]->IsTrue() && ts_language_field_count(language) > UINT8_MAX) {
+    Nan::ThrowError("Trees of languages with more than 255 fields can't be serialized");
+    return;
+  }
+
+  Local<Array> paths = info[0].As<Array>();
+  auto batch = std::make_shared<Batch>();
+  batch->callback.Reset(info[6].As<Function>());
+
+  double mmap_limit = info[2]->IsNumber() ? Nan::To<double>(info[2]).FromJust() : 0;
+  batch->mmap_limit = mmap_limit > 0 ? mmap_limit : kDefaultMmapLimit;
+
+  // 0 means no timeout, like ts_parser_set_timeout_micros.
+  double timeout_micros = info[3]->IsNumber() ? Nan::To<double>(info[3]).FromJust() : 0;
+  batch->timeout_micros = timeout_micros > 0 ? timeout_micros : 0;
+  batch->serialize_tree = info[4]->IsTrue();
+  batch->check_only = info[5]->IsTrue();
+  batch->files.resize(paths->Length());
+
+  for (uint32_t i = 0; i < paths->Length(); i++) {
+    Nan::Utf8String path(Nan::Get(paths, i).ToLocalChecked());
+    batch->files[i].path = std::string(*path, path.length());
+  }
+
+  unsigned threads = info[1]->IsUint32() ? Nan::To<uint32_t>(info[1]).FromJust() : 0;
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  if (threads > batch->files.size()) threads = batch->files.size();
+  if (threads == 0) threads = 1;
+
+  // Make sure the symbol table exists before workers race to create it.
+  GetSymbols();
+
+  batch->id = next_batch_id++;
+  running_batches[batch->id] = batch;
+
+  batch->running_workers = threads;
+  for (unsigned i = 0; i < threads; i++) Nan::AsyncQueueWorker(new ParseWorker(batch));
+
+  info.GetReturnValue().Set(batch->id);
+}
+
+// cancelParseFiles(id) stops a running batch. Workers stop between files and Tree-sitter checks
+// the flag while parsing, so a batch stuck on one huge file stops too. Unknown ids are ignored.
+NAN_METHOD(CancelParseFiles) {
+  if (!info[0]->IsUint32()) {
+    Nan::ThrowTypeError("Expected cancelParseFiles(id)");
+    return;
+  }
+
+  auto running = running_batches.find(Nan::To<uint32_t>(info[0]).FromJust());
+  if (running == running_batches.end()) return;
+
+  if (std::shared_ptr<Batch> batch = running->second.lock()) {
+    batch->cancelled.store(1, std::memory_order_relaxed);
+  }
+}
+
+void Init(Local<Object> exports) {
+  Nan::SetMethod(exports, "setLanguage", SetLanguage);
+  Nan::SetMethod(exports, "parseFiles", ParseFiles);
+  Nan::SetMethod(exports, "cancelParseFiles", CancelParseFiles);
+}
+
+NODE_MODULE(tree_sitter_hack_parse_files, Init)
+
+}  // namespace
@@ -0,0 +1,297 @@
+//! Parse throughput benchmark over the repos pulled by `bin/fetch-examples`. Rust counterpart of
+//! `bench/parse.c` that goes through the `tree-sitter` crate instead of the C API.
+//!
+//! ```sh
+//! $ cargo bench --bench parse -- --save tmp/bench-rust-baseline
+//! $ cargo bench --bench parse -- --baseline tmp/bench-rust-baseline --threshold 5
+//! ```
+//!
+//! Baselines use the same format as `bench/parse.c` so the two can be compared by hand.
+
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::process;
+use std::time::Instant;
+
+const EXAMPLES: &[&str] = &[
+    "examples/hack-sql-fake",
+    "examples/hack-json-schema",
+    "examples/hhvm/hphp/hack/test",
+];
+
+struct Metric {
+    name: &'static str,
+    value: f64,
+    /// Informational metrics describe the input and can't regress.
+    informational: bool,
+    higher_is_better: bool,
+}
+
+struct Options {
+    iterations: usize,
+    baseline: Option<PathBuf>,
+    save: Option<PathBuf>,
+    threshold: f64,
+}
+
+fn usage() -> ! {
+    eprintln!(
+        "usage: cargo bench --bench parse -- [--iterations N] [--baseline FILE] [--save FILE] \
+         [--threshold PERCENT]"
+    );
+    process::exit(1);
+}
+
+fn options() -> Options {
+    let mut options = Options {
+        iterations: 1,
+        baseline: None,
+        save: None,
+        threshold: 10.0,
+    };
+
+    // `cargo bench` passes `--bench` to benchmarks without the default harness.
+    let mut args = std::env::args().skip(1).filter(|arg| arg != "--bench");
+
+    while let Some(arg) = args.next() {
+        let value = args.next().unwrap_or_else(|| usage());
+        match arg.as_str() {
+            "--iterations" => options.iterations = value.parse().unwrap_or_else(|_| usage()),
+            "--baseline" => options.baseline = Some(value.into()),
+            "--save" => options.save = Some(value.into()),
+            "--threshold" => options.threshold = value.parse().unwrap_or_else(|_| usage()),
+            _ => usage(),
+        }
+    }
+
+    if options.iterations == 0 {
+        usage();
+    }
+
+    options
+}
+
+fn find_hack(dir: &Path, paths: &mut Vec<PathBuf>) {
+    let entries = match fs::read_dir(dir) {
+        Ok(entries) => entries,
+        Err(_) => return,
+    };
+
+    for entry in entries.flatten() {
+        let path = entry.path();
+        if path.is_dir() {
+            find_hack(&path, paths);
+        } else if matches!(
+            path.extension().and_then(|ext| ext.to_str()),
+            Some("hack" | "php")
+        ) {
+            paths.push(path);
+        }
+    }
+}
+
+fn count_nodes(tree: &tree_sitter::Tree) -> u64 {
+    let mut cursor = tree.walk();
+    let mut count = 1;
+
+    loop {
+        if cursor.goto_first_child() {
+            count += 1;
+            continue;
+        }
+
+        while !cursor.goto_next_sibling() {
+            if !cursor.goto_parent() {
+                return count;
+            }
+        }
+
+        count += 1;
+    }
+}
+
+/// Nearest-rank percentile of a sorted slice.
+fn percentile(sorted: &[f64], percent: usize) -> f64 {
+    if sorted.is_empty() {
+        return 0.0;
+    }
+    let rank = (sorted.len() * percent + 99) / 100;
+    sorted[rank.saturating_sub(1)]
+}
+
+/// Peak resident set size in kilobytes. Only available on Linux.
+fn peak_rss_kb() -> f64 {
+    fs::read_to_string("/proc/self/status")
+        .ok()
+        .and_then(|status| {
+            status
+                .lines()
+                .find(|line| line.starts_with("VmHWM:"))
+                .and_then(|line| line.split_whitespace().nth(1))
+                .and_then(|kb| kb.parse().ok())
+        })
+        .unwrap_or(0.0)
+}
+
+/// Returns the number of metrics that regressed by more than `threshold` percent.
+fn compare_baseline(path: &Path, metrics: &[Metric], threshold: f64) -> usize {
+    let baseline = match fs::read_to_string(path) {
+        Ok(baseline) => baseline,
+        Err(_) => {
+            eprintln!(
+                "No baseline at {0}. Create one with --save {0}",
+                path.display()
+            );
+            return 0;
+        }
+    };
+
+    let mut regressions = 0;
+
+    println!(
+        "\n{:<10} {:>14} {:>14} {:>8}",
+        "metric", "baseline", "current", "change"
+    );
+
+    for line in baseline.lines() {
+        let mut parts = line.splitn(2, '\t');
+        let (name, previous) = match (
+            parts.next(),
+            parts.next().and_then(|v| v.parse::<f64>().ok()),
+        ) {
+            (Some(name), Some(previous)) => (name, previous),
+            _ => continue,
+        };
+
+        if let Some(metric) = metrics.iter().find(|metric| metric.name == name) {
+            let change = if previous != 0.0 {
+                (metric.value - previous) * 100.0 / previous
+            } else {
+                0.0
+            };
+            let worse = if metric.higher_is_better {
+                -change
+            } else {
+                change
+            };
+            let regressed = !metric.informational && worse > threshold;
+
+            println!(
+                "{:<10} {:>14.3} {:>14.3} {:>+7.1}%{}",
+                name,
+                previous,
+                metric.value,
+                change,
+                if regressed { "  REGRESSION" } else { "" }
+            );
+
+            if regressed {
+                regressions += 1;
+            }
+        }
+    }
+
+    regressions
+}
+
+fn main() {
+    let options = options();
+    let root = Path::new(env!("CARGO_MANIFEST_DIR"));
+
+    let mut paths = Vec::new();
+    for example in EXAMPLES {
+        let dir = root.join(example);
+        if !dir.is_dir() {
+            eprintln!("{} not found. Run bin/fetch-examples first.", example);
+            process::exit(1);
+        }
+        find_hack(&dir, &mut paths);
+    }
+    paths.sort();
+
+    let mut parser = tree_sitter::Parser::new();
+    parser
+        .set_language(tree_sitter_hack::language())
+        .expect("Error loading hack language");
+
+    let mut latencies = Vec::with_capacity(paths.len());
+    let (mut total_ms, mut total_bytes, mut total_nodes) = (0.0, 0, 0);
+
+    for path in &paths {
+        let source = match fs::read(path) {
+            Ok(source) => source,
+            Err(error) => {
+                eprintln!("Could not read {}: {}", path.display(), error);
+                continue;
+            }
+        };
+
+        let mut fastest = f64::MAX;
+        let mut tree = None;
+
+        for _ in 0..options.iterations {
+            // Free the previous tree outside the timed region.
+            drop(tree.take());
+            let start = Instant::now();
+            tree = parser.parse(&source, None);
+            fastest = fastest.min(start.elapsed().as_secs_f64() * 1e3);
+        }
+
+        total_nodes += tree.as_ref().map_or(0, count_nodes);
+        total_bytes += source.len();
+        total_ms += fastest;
+        latencies.push(fastest);
+    }
+
+    latencies.sort_by(|a, b| a.partial_cmp(b).unwrap());
+
+    let seconds = total_ms / 1e3;
+    let per_sec = |total: f64| if seconds > 0.0 { total / seconds } else { 0.0 };
+    let metric = |name, value, informational, higher_is_better| Metric {
+        name,
+        value,
+        informational,
+        higher_is_better,
+    };
+
+    let metrics = [
+        metric("files", latencies.len() as f64, true, true),
+        metric("bytes", total_bytes as f64, true, true),
+        metric("nodes", total_nodes as f64, true, true),
+        metric("bytes/sec", per_sec(total_bytes as f64), false, true),
+        metric("nodes/sec", per_sec(total_nodes as f64), false, true),
+        metric("p50 ms", percentile(&latencies, 50), false, false),
+        metric("p99 ms", percentile(&latencies, 99), false, false),
+        metric("rss KB", peak_rss_kb(), false, false),
+    ];
+
+    for metric in &metrics {
+        let precision = if metric.name.ends_with(" ms") { 3 } else { 0 };
+        println!("{:<10} {:.*}", metric.name, precision, metric.value);
+    }
+
+    let regressions = options.baseline.as_ref().map_or(0, |path| {
+        compare_baseline(path, &metrics, options.threshold)
+    });
+
+    if let Some(path) = &options.save {
+        let baseline: String = metrics
+            .iter()
+            .map(|metric| format!("{}\t{:.6}\n", metric.name, metric.value))
+            .collect();
+        fs::write(path, baseline).unwrap_or_else(|error| {
+            eprintln!("Could not write baseline {}: {}", path.display(), error);
+            process::exit(1);
+        });
+    }
+
+    if regressions > 0 {
+        eprintln!(
+            "\n{} metric{} regressed by more than {:.1}%",
+            regressions,
+            if regressions == 1 { "" } else { "s" },
+            options.threshold
+        );
+        process::exit(1);
+    }
+}
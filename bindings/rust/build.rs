@@ -8,7 +8,41 @@ fn main() {
         .flag_if_supported("-Wno-unused-but-set-variable")
         .flag_if_supported("-Wno-trigraphs");
     let parser_path = src_dir.join("parser.c");
-    c_config.file(&parser_path);
+
+    // The instrumentation build compiles instrument.c, which includes parser.c. See src/instrument.h.
+    if std::env::var_os("CARGO_FEATURE_INSTRUMENT").is_some() {
+        let instrument_path = src_dir.join("instrument.c");
+        c_config
+            .define("TREE_SITTER_HACK_INSTRUMENT", None)
+            .file(&instrument_path);
+        println!(
+            "cargo:rerun-if-changed={}",
+            instrument_path.to_str().unwrap()
+        );
+    } else {
+        c_config.file(&parser_path);
+    }
+
+    // Production builds: -O3 even in debug builds, calls into libc without the PLT and, with a
+    // clang profile from bin/benchmark-build, profile-guided optimization. There's no LTO since the
+    // runtime only calls the parser through the function pointers in TSLanguage.
+    if std::env::var_os("CARGO_FEATURE_OPTIMIZE").is_some() {
+        c_config.opt_level(3).flag_if_supported("-fno-plt");
+
+        println!("cargo:rerun-if-env-changed=TREE_SITTER_HACK_PGO_PROFILE");
+        if let Some(profile) = std::env::var_os("TREE_SITTER_HACK_PGO_PROFILE") {
+            if c_config.get_compiler().is_like_clang() {
+                let profile = profile.to_str().unwrap();
+                c_config
+                    .flag(&format!("-fprofile-instr-use={}", profile))
+                    .flag("-Wno-profile-instr-unprofiled")
+                    .flag("-Wno-profile-instr-out-of-date");
+                println!("cargo:rerun-if-changed={}", profile);
+            } else {
+                println!("cargo:warning=TREE_SITTER_HACK_PGO_PROFILE needs clang, set CC=clang");
+            }
+        }
+    }
 
     let scanner_path = src_dir.join("scanner.c");
     c_config.file(&scanner_path);
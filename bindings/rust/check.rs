@@ -0,0 +1,172 @@
+//! Check whether files are syntactically valid without doing anything else with their trees.
+//!
+//! ```no_run
+//! use tree_sitter_hack::check::{check_files, Check};
+//!
+//! let paths = ["src/Foo.hack", "src/Bar.hack"];
+//! for (path, result) in paths.iter().zip(check_files(&paths, 4)) {
+//!     match result {
+//!         Ok(Check::Valid) => {}
+//!         Ok(Check::Invalid(e)) => println!("{}:{}: {}", path, e.start_point.row + 1, e.kind),
+//!         Ok(Check::TimedOut) => println!("{}: timed out", path),
+//!         Err(e) => println!("{}: {}", path, e),
+//!     }
+//! }
+//! ```
+//!
+//! Tree-sitter still builds the whole tree, but a valid file is known to be valid from its root
+//! node alone, and an invalid one only visits the nodes on the way to its first error.
+
+use crate::file::FileParser;
+use crate::pool::ParserPool;
+use std::io;
+use std::path::Path;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Mutex;
+use tree_sitter::{Node, Parser, Point};
+
+/// The result of checking one file.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub enum Check {
+    Valid,
+    /// The first syntax error in the file.
+    Invalid(SyntaxError),
+    /// The parser's timeout, or [`FileParser::timeout_micros`], ran out first.
+    TimedOut,
+}
+
+impl Check {
+    pub fn is_valid(&self) -> bool {
+        *self == Check::Valid
+    }
+}
+
+/// An `ERROR` node, or a node the parser inserted because it was missing.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct SyntaxError {
+    /// `ERROR` or the kind of the missing node.
+    pub kind: &'static str,
+    pub is_missing: bool,
+    pub start_byte: usize,
+    pub end_byte: usize,
+    pub start_point: Point,
+    pub end_point: Point,
+}
+
+impl From<Node<'_>> for SyntaxError {
+    fn from(node: Node) -> Self {
+        SyntaxError {
+            kind: node.kind(),
+            is_missing: node.is_missing(),
+            start_byte: node.start_byte(),
+            end_byte: node.end_byte(),
+            start_point: node.start_position(),
+            end_point: node.end_position(),
+        }
+    }
+}
+
+/// The first `ERROR` or missing node under `node` in document order, only descending into
+/// subtrees that contain one.
+pub fn first_error(node: Node) -> Option<Node> {
+    if !node.has_error() {
+        return None;
+    }
+
+    let mut cursor = node.walk();
+    loop {
+        let node = cursor.node();
+        if node.is_error() || node.is_missing() {
+            return Some(node);
+        }
+
+        // `has_error` is set on every ancestor of an error, so one of the children has it.
+        if !cursor.goto_first_child() {
+            return None;
+        }
+        while !cursor.node().has_error() {
+            if !cursor.goto_next_sibling() {
+                return None;
+            }
+        }
+    }
+}
+
+/// Parse `source` and check it.
+pub fn check(parser: &mut Parser, source: &[u8]) -> Check {
+    match parser.parse(source, None) {
+        Some(tree) => result(tree.root_node()),
+        None => {
+            parser.reset();
+            Check::TimedOut
+        }
+    }
+}
+
+/// Read and check the file at `path`, memory mapping it like [`crate::file::parse_file`].
+pub fn check_file(parser: &mut Parser, path: impl AsRef<Path>) -> io::Result<Check> {
+    FileParser::default().check(parser, path)
+}
+
+/// Check `paths` on `threads` threads, or one per CPU if `threads` is 0. The results are in the
+/// same order as `paths`.
+pub fn check_files<P: AsRef<Path> + Sync>(paths: &[P], threads: usize) -> Vec<io::Result<Check>> {
+    FileParser::default().check_files(paths, threads)
+}
+
+impl FileParser {
+    /// Like [`check_file`], with these options.
+    pub fn check(&self, parser: &mut Parser, path: impl AsRef<Path>) -> io::Result<Check> {
+        let file = self.parse(parser, path, None)?;
+        Ok(match file.tree {
+            Some(tree) => result(tree.root_node()),
+            None => Check::TimedOut,
+        })
+    }
+
+    /// Like [`check_files`], with these options.
+    pub fn check_files<P: AsRef<Path> + Sync>(
+        &self,
+        paths: &[P],
+        threads: usize,
+    ) -> Vec<io::Result<Check>> {
+        let threads = match threads {
+            0 => std::thread::available_parallelism().map_or(1, |n| n.get()),
+            n => n,
+        }
+        .min(paths.len());
+
+        let pool = ParserPool::with_max_idle(threads);
+        let next = AtomicUsize::new(0);
+        let results: Vec<_> = paths.iter().map(|_| Mutex::new(None)).collect();
+
+        // Files are handed out one at a time rather than in fixed slices, so a thread that gets a
+        // large file doesn't hold up the rest.
+        std::thread::scope(|scope| {
+            for _ in 0..threads {
+                scope.spawn(|| {
+                    let mut parser = pool.get();
+                    loop {
+                        let i = next.fetch_add(1, Ordering::Relaxed);
+                        if i >= paths.len() {
+                            break;
+                        }
+                        *results[i].lock().unwrap() = Some(self.check(&mut parser, &paths[i]));
+                    }
+                });
+            }
+        });
+
+        results
+            .into_iter()
+            .map(|result| result.into_inner().unwrap().unwrap())
+            .collect()
+    }
+}
+
+fn result(root: Node) -> Check {
+    match first_error(root) {
+        Some(error) => Check::Invalid(error.into()),
+        None => Check::Valid,
+    }
+}
@@ -0,0 +1,162 @@
+//! Parse files without copying them into a `String` first.
+//!
+//! ```no_run
+//! let mut parser = tree_sitter::Parser::new();
+//! parser.set_language(tree_sitter_hack::language()).unwrap();
+//!
+//! let file = tree_sitter_hack::file::parse_file(&mut parser, "src/Foo.hack", None).unwrap();
+//! let source = file.source.as_deref().unwrap();
+//! let tree = file.tree.unwrap();
+//! println!("{}", tree.root_node().child(0).unwrap().utf8_text(source).unwrap());
+//! ```
+//!
+//! Files up to [`FileParser::mmap_limit`] bytes are memory mapped and Tree-sitter reads straight out
+//! of the mapping. Larger files are streamed in [`FileParser::chunk_size`] chunks so a sweep over
+//! huge files doesn't keep them all mapped.
+//!
+//! Set [`FileParser::timeout_micros`] or a cancellation flag on the parser so a pathological file
+//! can't stall a worker. A parse that stops early returns `tree: None` and resets the parser, so
+//! the next file starts from scratch instead of resuming it.
+
+use memmap2::Mmap;
+use std::fs::File;
+use std::io::{self, Read, Seek, SeekFrom};
+use std::path::Path;
+use tree_sitter::{Parser, Tree};
+
+/// A parsed file.
+pub struct ParsedFile {
+    /// `None` if parsing was cancelled or timed out, like [`Parser::parse`].
+    pub tree: Option<Tree>,
+    /// The mapped file, for reading node text. `None` if the file was streamed.
+    pub source: Option<Mmap>,
+}
+
+/// Options for [`FileParser::parse`].
+#[derive(Clone, Copy, Debug)]
+pub struct FileParser {
+    /// Files larger than this many bytes are streamed instead of memory mapped.
+    pub mmap_limit: u64,
+    /// Bytes read per Tree-sitter read callback when streaming.
+    pub chunk_size: usize,
+    /// Give up on a file after this many microseconds of parsing. `None` keeps the parser's own
+    /// timeout, see [`Parser::set_timeout_micros`].
+    pub timeout_micros: Option<u64>,
+}
+
+impl Default for FileParser {
+    fn default() -> Self {
+        FileParser {
+            mmap_limit: 256 << 20,
+            chunk_size: 64 << 10,
+            timeout_micros: None,
+        }
+    }
+}
+
+impl FileParser {
+    pub fn parse(
+        &self,
+        parser: &mut Parser,
+        path: impl AsRef<Path>,
+        old_tree: Option<&Tree>,
+    ) -> io::Result<ParsedFile> {
+        let timeout_micros = parser.timeout_micros();
+        if let Some(timeout) = self.timeout_micros {
+            parser.set_timeout_micros(timeout);
+        }
+
+        let result = self.parse_source(parser, path.as_ref(), old_tree);
+        parser.set_timeout_micros(timeout_micros);
+
+        // Otherwise the next parse would try to resume this one.
+        if !matches!(result, Ok(ParsedFile { tree: Some(_), .. })) {
+            parser.reset();
+        }
+
+        result
+    }
+
+    fn parse_source(
+        &self,
+        parser: &mut Parser,
+        path: &Path,
+        old_tree: Option<&Tree>,
+    ) -> io::Result<ParsedFile> {
+        let file = File::open(path)?;
+        let length = file.metadata()?.len();
+
+        // Mapping an empty file fails on some platforms.
+        if length == 0 {
+            return Ok(ParsedFile {
+                tree: parser.parse(&[], old_tree),
+                source: None,
+            });
+        }
+
+        if length <= self.mmap_limit {
+            // Safety: the mapping is only read. Like any mmap user, this can't stop another
+            // process from truncating or rewriting the file while it's mapped.
+            let source = unsafe { Mmap::map(&file)? };
+            return Ok(ParsedFile {
+                tree: parser.parse(&source[..], old_tree),
+                source: Some(source),
+            });
+        }
+
+        let tree = self.stream(parser, file, old_tree)?;
+        Ok(ParsedFile { tree, source: None })
+    }
+
+    fn stream(
+        &self,
+        parser: &mut Parser,
+        mut file: File,
+        old_tree: Option<&Tree>,
+    ) -> io::Result<Option<Tree>> {
+        let mut error = None;
+        let chunk_size = self.chunk_size.max(1);
+
+        let tree = parser.parse_with(
+            &mut |offset, _| {
+                if error.is_some() {
+                    return Vec::new();
+                }
+
+                // Tree-sitter keeps the returned chunk until the next callback, so each read gets
+                // its own buffer.
+                let mut chunk = vec![0; chunk_size];
+                let read = file
+                    .seek(SeekFrom::Start(offset as u64))
+                    .and_then(|_| file.read(&mut chunk));
+
+                match read {
+                    Ok(length) => {
+                        chunk.truncate(length);
+                        chunk
+                    }
+                    Err(e) => {
+                        // An empty chunk ends the input. The error is returned after parsing.
+                        error = Some(e);
+                        Vec::new()
+                    }
+                }
+            },
+            old_tree,
+        );
+
+        match error {
+            Some(error) => Err(error),
+            None => Ok(tree),
+        }
+    }
+}
+
+/// Parse a file with the default [`FileParser`] options.
+pub fn parse_file(
+    parser: &mut Parser,
+    path: impl AsRef<Path>,
+    old_tree: Option<&Tree>,
+) -> io::Result<ParsedFile> {
+    FileParser::default().parse(parser, path, old_tree)
+}
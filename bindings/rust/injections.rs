@@ -0,0 +1,110 @@
+//! Parse the SQL, JSON and GraphQL in heredocs on the same buffer as the Hack around them.
+//!
+//! ```no_run
+//! # fn sql() -> tree_sitter::Language { unimplemented!() }
+//! let code = "<?hh\n$q = <<<SQL\nSELECT * FROM users WHERE id = $id\nSQL;\n";
+//! let mut parser = tree_sitter::Parser::new();
+//! parser.set_language(tree_sitter_hack::language()).unwrap();
+//! let tree = parser.parse(code, None).unwrap();
+//!
+//! let mut sql_parser = tree_sitter::Parser::new();
+//! sql_parser.set_language(sql()).unwrap();
+//! for injection in tree_sitter_hack::injections::heredocs(tree.root_node(), code.as_bytes()) {
+//!     if injection.language == "sql" {
+//!         sql_parser.set_included_ranges(&injection.ranges).unwrap();
+//!         let sql_tree = sql_parser.parse(code, None).unwrap();
+//!     }
+//! }
+//! ```
+//!
+//! The language comes from the `injection.language` setting of the pattern in
+//! [`INJECTIONS_QUERY`](crate::INJECTIONS_QUERY) that matched, so the delimiters map to the same
+//! languages here as in editors that read the query.
+
+use tree_sitter::{Node, Point, QueryCursor, Range};
+
+/// A heredoc whose body is in another language.
+#[derive(Clone, Debug)]
+pub struct Injection<'tree> {
+    /// The `injection.language` of the heredoc's delimiter, e.g. `sql`.
+    pub language: &'static str,
+    pub heredoc: Node<'tree>,
+    /// The body of the heredoc, without the delimiter lines and split around variables and
+    /// embedded expressions. Never empty, since an empty list of included ranges means the whole
+    /// document.
+    pub ranges: Vec<Range>,
+}
+
+/// Every heredoc under `node` with a delimiter for another language, in order.
+pub fn heredocs<'tree>(node: Node<'tree>, source: &[u8]) -> Vec<Injection<'tree>> {
+    let query = crate::injections_query();
+    let mut cursor = QueryCursor::new();
+
+    cursor
+        .matches(query, node, source)
+        .filter_map(|m| {
+            let language = query
+                .property_settings(m.pattern_index)
+                .iter()
+                .find(|property| &*property.key == "injection.language")?
+                .value
+                .as_deref()?;
+            let heredoc = m.captures.first()?.node;
+            let ranges = heredoc_ranges(heredoc, source);
+            if ranges.is_empty() {
+                return None;
+            }
+
+            Some(Injection {
+                language,
+                heredoc,
+                ranges,
+            })
+        })
+        .collect()
+}
+
+/// The body of `heredoc`: from the line after the opening delimiter to the newline before the
+/// closing one, with variables and embedded expressions cut out. Empty if the body is.
+pub fn heredoc_ranges(heredoc: Node, source: &[u8]) -> Vec<Range> {
+    let text = &source[heredoc.byte_range()];
+    let (first, last) = match (
+        text.iter().position(|&c| c == b'\n'),
+        text.iter().rposition(|&c| c == b'\n'),
+    ) {
+        (Some(first), Some(last)) if first < last => (first, last),
+        _ => return Vec::new(),
+    };
+
+    let end_byte = heredoc.start_byte() + last + 1;
+    let end_point = Point::new(heredoc.end_position().row, 0);
+
+    let mut ranges = Vec::new();
+    let mut start_byte = heredoc.start_byte() + first + 1;
+    let mut start_point = Point::new(heredoc.start_position().row + 1, 0);
+
+    let mut cursor = heredoc.walk();
+    for child in heredoc.named_children(&mut cursor) {
+        if child.start_byte() > start_byte {
+            ranges.push(Range {
+                start_byte,
+                end_byte: child.start_byte(),
+                start_point,
+                end_point: child.start_position(),
+            });
+        }
+        start_byte = child.end_byte();
+        start_point = child.end_position();
+    }
+
+    if end_byte > start_byte {
+        ranges.push(Range {
+            start_byte,
+            end_byte,
+            start_point,
+            end_point,
+        });
+    }
+
+    ranges
+}
@@ -0,0 +1,82 @@
+//! Counters from the instrumentation build, enabled with the `instrument` feature. See
+//! `src/instrument.h`.
+//!
+//! ```
+//! let mut parser = tree_sitter::Parser::new();
+//! parser.set_language(tree_sitter_hack::language()).unwrap();
+//!
+//! tree_sitter_hack::instrument::reset();
+//! parser.parse("<?hh\n$x = <<<EOF\nhello\nEOF;\n", None).unwrap();
+//!
+//! let stats = tree_sitter_hack::instrument::stats();
+//! assert!(stats.scan_start.calls > 0);
+//! ```
+//!
+//! Counters are global to the process and include every parser using this language.
+
+use std::slice;
+
+/// Counters for one of the external scanner functions.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct ScanCounters {
+    pub calls: u64,
+    /// Characters advanced over, including skipped ones. `scan_body` includes the characters of the
+    /// delimiter checks it makes.
+    pub advances: u64,
+    pub failures: u64,
+}
+
+/// Mirrors `TreeSitterHackStats`.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct Stats {
+    /// Calls to the external scanner.
+    pub scans: u64,
+    /// Scans that advanced and then returned false. Tree-sitter throws their work away and lexes
+    /// the same characters again with the internal lexer.
+    pub rollbacks: u64,
+    pub rollback_advances: u64,
+    pub scan_start: ScanCounters,
+    pub scan_body: ScanCounters,
+    pub scan_delimiter: ScanCounters,
+    /// Calls to the generated `ts_lex` and `ts_lex_keywords` functions.
+    pub lex_calls: u64,
+    pub keyword_lex_calls: u64,
+}
+
+extern "C" {
+    fn tree_sitter_hack_instrument_stats(stats: *mut Stats);
+    fn tree_sitter_hack_instrument_lex_states(keywords: bool, count: *mut u32) -> *const u64;
+    fn tree_sitter_hack_instrument_reset();
+}
+
+/// A snapshot of the current counters.
+pub fn stats() -> Stats {
+    let mut stats = Stats::default();
+    unsafe { tree_sitter_hack_instrument_stats(&mut stats) };
+    stats
+}
+
+fn states(keywords: bool) -> Vec<u64> {
+    let mut count = 0;
+    unsafe {
+        let states = tree_sitter_hack_instrument_lex_states(keywords, &mut count);
+        slice::from_raw_parts(states, count as usize).to_vec()
+    }
+}
+
+/// Number of times each `ts_lex` state was entered, indexed by state.
+pub fn lex_states() -> Vec<u64> {
+    states(false)
+}
+
+/// Number of times each `ts_lex_keywords` state was entered, indexed by state.
+pub fn keyword_lex_states() -> Vec<u64> {
+    states(true)
+}
+
+/// Zero all counters.
+pub fn reset() {
+    unsafe { tree_sitter_hack_instrument_reset() }
+}
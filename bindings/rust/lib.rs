@@ -15,7 +15,18 @@
 //! [Parser]: https://docs.rs/tree-sitter/*/tree_sitter/struct.Parser.html
 //! [tree-sitter]: https://tree-sitter.github.io/
 
-use tree_sitter::Language;
+use std::sync::OnceLock;
+use tree_sitter::{Language, Query};
+
+pub mod check;
+pub mod file;
+pub mod ids;
+pub mod injections;
+#[cfg(feature = "instrument")]
+pub mod instrument;
+pub mod pool;
+pub mod serialize;
+pub mod top_level;
 
 extern "C" {
     fn tree_sitter_hack() -> Language;
@@ -33,12 +44,72 @@ pub fn language() -> Language {
 /// [`node-types.json`]: https://tree-sitter.github.io/tree-sitter/using-parsers#static-node-types
 pub const NODE_TYPES: &'static str = include_str!("../../src/node-types.json");
 
-// Uncomment these to include any queries that this grammar contains
+/// The syntax highlighting query for this language.
+pub const HIGHLIGHTS_QUERY: &'static str = include_str!("../../queries/highlights.scm");
+
+/// The local variable query for this language.
+pub const LOCALS_QUERY: &'static str = include_str!("../../queries/locals.scm");
+
+/// The symbol tagging query for this language.
+pub const TAGS_QUERY: &'static str = include_str!("../../queries/tags.scm");
+
+/// The language injection query for this language.
+pub const INJECTIONS_QUERY: &'static str = include_str!("../../queries/injections.scm");
+
+fn compile_query(source: &str) -> Query {
+    Query::new(language(), source).expect("Error compiling bundled hack query")
+}
+
+/// [`HIGHLIGHTS_QUERY`] compiled on first use and shared by every thread in the process. Match
+/// captures against the indices in [`highlights`] instead of looking up their names.
+///
+/// ```
+/// let mut parser = tree_sitter::Parser::new();
+/// parser.set_language(tree_sitter_hack::language()).unwrap();
+/// let code = "<?hh\n// hello\n";
+/// let tree = parser.parse(code, None).unwrap();
+///
+/// let mut cursor = tree_sitter::QueryCursor::new();
+/// let query = tree_sitter_hack::highlights_query();
+/// for (m, index) in cursor.captures(query, tree.root_node(), code.as_bytes()) {
+///     let capture = m.captures[index];
+///     if capture.index == tree_sitter_hack::highlights::COMMENT {
+///         assert_eq!(capture.node.kind(), "comment");
+///     }
+/// }
+/// ```
+pub fn highlights_query() -> &'static Query {
+    static QUERY: OnceLock<Query> = OnceLock::new();
+    QUERY.get_or_init(|| compile_query(HIGHLIGHTS_QUERY))
+}
+
+/// Capture indices of [`highlights_query`]. Tree-sitter numbers captures in the order they first
+/// appear in the query.
+pub mod highlights {
+    pub const COMMENT: u32 = 0;
+    pub const STRING: u32 = 1;
+    pub const KEYWORD: u32 = 2;
+    pub const TYPE: u32 = 3;
+}
+
+/// [`LOCALS_QUERY`] compiled on first use and shared by every thread in the process.
+pub fn locals_query() -> &'static Query {
+    static QUERY: OnceLock<Query> = OnceLock::new();
+    QUERY.get_or_init(|| compile_query(LOCALS_QUERY))
+}
 
-// pub const HIGHLIGHTS_QUERY: &'static str = include_str!("../../queries/highlights.scm");
-// pub const INJECTIONS_QUERY: &'static str = include_str!("../../queries/injections.scm");
-// pub const LOCALS_QUERY: &'static str = include_str!("../../queries/locals.scm");
-// pub const TAGS_QUERY: &'static str = include_str!("../../queries/tags.scm");
+/// [`INJECTIONS_QUERY`] compiled on first use and shared by every thread in the process. See
+/// [`injections::heredocs`] for the included ranges of each heredoc body.
+pub fn injections_query() -> &'static Query {
+    static QUERY: OnceLock<Query> = OnceLock::new();
+    QUERY.get_or_init(|| compile_query(INJECTIONS_QUERY))
+}
+
+/// [`TAGS_QUERY`] compiled on first use and shared by every thread in the process.
+pub fn tags_query() -> &'static Query {
+    static QUERY: OnceLock<Query> = OnceLock::new();
+    QUERY.get_or_init(|| compile_query(TAGS_QUERY))
+}
 
 #[cfg(test)]
 mod tests {
@@ -49,4 +120,352 @@ mod tests {
             .set_language(super::language())
             .expect("Error loading hack language");
     }
+
+    #[test]
+    fn test_can_compile_queries() {
+        assert!(super::locals_query().pattern_count() > 0);
+        assert!(super::tags_query().pattern_count() > 0);
+        assert!(super::injections_query().pattern_count() > 0);
+    }
+
+    #[test]
+    fn test_tags_definitions() {
+        let mut parser = tree_sitter::Parser::new();
+        parser.set_language(super::language()).unwrap();
+        let code = "<?hh\nconst int LIMIT = 10, MAX = 20;\n\
+                    function f(): void {}\n\
+                    class C {\n  const string NAME = 'c';\n  public function m(): void {}\n}\n";
+        let tree = parser.parse(code, None).unwrap();
+
+        let query = super::tags_query();
+        let name = query.capture_index_for_name("name").unwrap();
+        let mut cursor = tree_sitter::QueryCursor::new();
+        let mut definitions = Vec::new();
+        for m in cursor.matches(query, tree.root_node(), code.as_bytes()) {
+            let text = |index| {
+                let capture = m.captures.iter().find(|c| c.index == index)?;
+                capture.node.utf8_text(code.as_bytes()).ok()
+            };
+            let kind = m.captures.iter().find(|c| c.index != name).unwrap().index;
+            definitions.push((
+                query.capture_names()[kind as usize].as_str(),
+                text(name).unwrap(),
+            ));
+        }
+
+        assert_eq!(
+            definitions,
+            vec![
+                ("definition.constant", "LIMIT"),
+                ("definition.constant", "MAX"),
+                ("definition.function", "f"),
+                ("definition.class", "C"),
+                ("definition.constant", "NAME"),
+                ("definition.method", "m"),
+            ]
+        );
+    }
+
+    #[test]
+    fn test_heredoc_injections() {
+        let mut parser = tree_sitter::Parser::new();
+        parser.set_language(super::language()).unwrap();
+        let code = "<?hh\n$q = <<<SQL\nSELECT *\nFROM t WHERE id = $id\nSQL;\n\
+                    $j = <<<'JSON'\n{\"a\": 1}\nJSON;\n\
+                    $e = <<<SQL\nSQL;\n\
+                    $t = <<<TEXT\nhello\nTEXT;\n";
+        let tree = parser.parse(code, None).unwrap();
+
+        let injections = super::injections::heredocs(tree.root_node(), code.as_bytes());
+        let found: Vec<(&str, Vec<&str>)> = injections
+            .iter()
+            .map(|injection| {
+                let texts = injection.ranges.iter();
+                let texts = texts.map(|range| &code[range.start_byte..range.end_byte]);
+                (injection.language, texts.collect())
+            })
+            .collect();
+        assert_eq!(
+            found,
+            vec![
+                ("sql", vec!["SELECT *\nFROM t WHERE id = ", "\n"]),
+                ("json", vec!["{\"a\": 1}\n"]),
+            ]
+        );
+
+        // Points agree with bytes, so the ranges can be handed to another parser as they are.
+        let sql = &injections[0].ranges;
+        assert_eq!(sql[0].start_point, tree_sitter::Point::new(2, 0));
+        assert_eq!(sql[0].end_point, tree_sitter::Point::new(3, 18));
+        assert_eq!(sql[1].start_point, tree_sitter::Point::new(3, 21));
+        assert_eq!(sql[1].end_point, tree_sitter::Point::new(4, 0));
+    }
+
+    #[test]
+    fn test_ids_match_language() {
+        use super::ids::{verify, FIELDS, SYMBOLS};
+
+        verify(&super::language()).unwrap();
+
+        let mut parser = tree_sitter::Parser::new();
+        parser.set_language(super::language()).unwrap();
+        let code = "<?hh\nclass C { public function f(): ?int { return $this?->x ?? null; } }\n";
+        let tree = parser.parse(code, None).unwrap();
+
+        // Every node in a tree has one of the generated ids.
+        let mut cursor = tree.walk();
+        loop {
+            let id = cursor.node().kind_id();
+            assert!(SYMBOLS.iter().any(|&(symbol, _, _)| symbol == id));
+            if let Some(field) = cursor.field_id() {
+                assert!(FIELDS.iter().any(|&(id, _)| id == field));
+            }
+
+            if cursor.goto_first_child() {
+                continue;
+            }
+            while !cursor.goto_next_sibling() {
+                if !cursor.goto_parent() {
+                    return;
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn test_top_level_matches_whole_file() {
+        let mut parser = tree_sitter::Parser::new();
+        parser.set_language(super::language()).unwrap();
+
+        // Lines that look like items inside a heredoc and a comment, and an attribute on its own
+        // line, all need the following lines to parse.
+        let code = concat!(
+            "<?hh // strict\n",
+            "namespace N {\n  function inner(): void {}\n}\n",
+            "function f(): string {\n  return <<<EOT\nfunction g() {\nEOT;\n}\n",
+            "/*\nclass NotAClass {}\n*/\n",
+            "<<__EntryPoint>>\n",
+            "async function main(): Awaitable<void> {}\n",
+            "const int X = 1;\n",
+            "type T = shape('a' => int);\n",
+            "enum E: int {\n  A = 1;\n}\n",
+        );
+
+        let mut items = Vec::new();
+        let finished = super::top_level::parse(&mut parser, code.as_bytes(), |node, _| {
+            items.push((node.kind(), node.byte_range(), node.has_error()));
+        });
+        assert!(finished);
+
+        let tree = parser.parse(code, None).unwrap();
+        let root = tree.root_node();
+        let mut cursor = root.walk();
+        let expected: Vec<_> = root
+            .named_children(&mut cursor)
+            .filter(|node| !node.is_extra())
+            .map(|node| (node.kind(), node.byte_range(), node.has_error()))
+            .collect();
+
+        assert_eq!(items, expected);
+        assert!(!root.has_error());
+    }
+
+    #[test]
+    fn test_pool_parses_concurrently() {
+        use std::sync::atomic::AtomicUsize;
+
+        // Heredocs are the only scanner tokens with state. Interleaving them across threads would
+        // show up as wrong trees if any of it were shared.
+        let sources: Vec<String> = (0..8)
+            .map(|i| {
+                let mut source = String::from("<?hh\n");
+                for j in 0..=i {
+                    source += &format!(
+                        "function f{i}_{j}(): string {{\n  $a = <<<EOT{j}\n{{$x}} EOT{i}\nEOT{j};\n  \
+                         $b = <<<'N{i}'\n$y\nN{i};\n  return $a.$b;\n}}\n",
+                        i = i,
+                        j = j,
+                    );
+                }
+                source
+            })
+            .collect();
+
+        let mut parser = tree_sitter::Parser::new();
+        parser.set_language(super::language()).unwrap();
+        let expected: Vec<String> = sources
+            .iter()
+            .map(|source| parser.parse(source, None).unwrap().root_node().to_sexp())
+            .collect();
+        assert!(expected.iter().all(|sexp| !sexp.contains("ERROR")));
+
+        let pool = super::pool::ParserPool::with_max_idle(4);
+        let cancelled = AtomicUsize::new(1);
+        std::thread::scope(|scope| {
+            for thread in 0..8 {
+                let (pool, sources, expected, cancelled) = (&pool, &sources, &expected, &cancelled);
+                scope.spawn(move || {
+                    for round in 0..200 {
+                        let i = (thread + round) % sources.len();
+                        let mut parser = pool.get();
+
+                        // Return some parsers with a cancelled parse of the largest file, which
+                        // stops partway through its heredocs. The pool must reset them.
+                        if round % 7 == 0 {
+                            let largest = sources.last().unwrap();
+                            unsafe { parser.set_cancellation_flag(Some(cancelled)) };
+                            assert!(parser.parse(largest, None).is_none());
+                            continue;
+                        }
+
+                        let tree = parser.parse(&sources[i], None).unwrap();
+                        assert_eq!(tree.root_node().to_sexp(), expected[i]);
+                    }
+                });
+            }
+        });
+
+        assert!(pool.idle() <= 4);
+    }
+
+    #[test]
+    fn test_check_finds_first_error() {
+        use super::check::{check, first_error, Check};
+
+        let mut parser = tree_sitter::Parser::new();
+        parser.set_language(super::language()).unwrap();
+
+        assert_eq!(
+            check(&mut parser, b"<?hh\nfunction f(): void {}\n"),
+            Check::Valid
+        );
+
+        // The first error is the one a full walk would find first.
+        let source = b"<?hh\nfunction f(: void {}\nclass {}\nfunction g(): void { $x = ; }\n";
+        let tree = parser.parse(&source[..], None).unwrap();
+        let mut errors = Vec::new();
+        let mut cursor = tree.walk();
+        'walk: loop {
+            let node = cursor.node();
+            if node.is_error() || node.is_missing() {
+                errors.push(node);
+            }
+            if cursor.goto_first_child() || cursor.goto_next_sibling() {
+                continue;
+            }
+            while cursor.goto_parent() {
+                if cursor.goto_next_sibling() {
+                    continue 'walk;
+                }
+            }
+            break;
+        }
+        assert!(!errors.is_empty());
+        assert_eq!(first_error(tree.root_node()), Some(errors[0]));
+
+        match check(&mut parser, &source[..]) {
+            Check::Invalid(error) => assert_eq!(error.start_byte, errors[0].start_byte()),
+            result => panic!("expected an error, got {:?}", result),
+        }
+    }
+
+    #[test]
+    fn test_serialize_round_trip() {
+        use super::serialize::{flags, serialize, SerializedTree};
+
+        let mut parser = tree_sitter::Parser::new();
+        parser.set_language(super::language()).unwrap();
+        let code = "<?hh\nfunction f(int $x): void {\n  g($x,);\n}\n";
+        let tree = parser.parse(code, None).unwrap();
+
+        let bytes = serialize(&tree);
+        let nodes = SerializedTree::new(&bytes).unwrap();
+
+        let mut expected = Vec::new();
+        let mut cursor = tree.walk();
+        loop {
+            let node = cursor.node();
+            expected.push((node.kind_id(), cursor.field_id(), node.byte_range()));
+            if cursor.goto_first_child() {
+                continue;
+            }
+            while !cursor.goto_next_sibling() {
+                if !cursor.goto_parent() {
+                    break;
+                }
+            }
+            if cursor.node() == tree.root_node() {
+                break;
+            }
+        }
+
+        assert_eq!(nodes.len(), expected.len());
+        for (node, (symbol, field, range)) in nodes.nodes().zip(expected) {
+            assert_eq!(node.symbol, symbol);
+            assert_eq!(node.field, field.unwrap_or(0) as u8);
+            assert_eq!(node.start_byte as usize..node.end_byte as usize, range);
+        }
+
+        let root = nodes.get(0).unwrap();
+        assert_eq!(root.flags & flags::NAMED, flags::NAMED);
+        assert_eq!(root.child_count as usize, tree.root_node().child_count());
+        let children: u32 = nodes.nodes().map(|node| node.child_count).sum();
+        assert_eq!(children as usize, nodes.len() - 1);
+    }
+
+    #[test]
+    fn test_highlights_capture_indices() {
+        use super::highlights::*;
+
+        let names = super::highlights_query().capture_names();
+        let captures = [
+            (COMMENT, "comment"),
+            (STRING, "string"),
+            (KEYWORD, "keyword"),
+            (TYPE, "type"),
+        ];
+
+        assert_eq!(names.len(), captures.len());
+        for (index, name) in &captures {
+            assert_eq!(names[*index as usize], *name);
+        }
+    }
+
+    // See the comment at the top of queries/highlights.scm.
+    #[test]
+    fn test_highlights_are_single_node_patterns() {
+        let query = super::highlights_query();
+        let source = super::HIGHLIGHTS_QUERY;
+
+        for pattern in 0..query.pattern_count() {
+            let start = query.start_byte_for_pattern(pattern);
+            let end = if pattern + 1 < query.pattern_count() {
+                query.start_byte_for_pattern(pattern + 1)
+            } else {
+                source.len()
+            };
+
+            let (mut depth, mut max_depth) = (0, 0);
+            let mut chars = source[start..end].chars();
+            while let Some(c) = chars.next() {
+                match c {
+                    '"' => while !matches!(chars.next(), Some('"') | None) {},
+                    ';' => while !matches!(chars.next(), Some('\n') | None) {},
+                    '(' => {
+                        depth += 1;
+                        max_depth = std::cmp::max(depth, max_depth);
+                    }
+                    ')' => depth -= 1,
+                    '#' => panic!("pattern {} has a predicate", pattern),
+                    _ => {}
+                }
+            }
+
+            assert!(
+                max_depth <= 1,
+                "pattern {} matches more than one node",
+                pattern
+            );
+        }
+    }
 }
@@ -0,0 +1,115 @@
+//! Reuse parsers across requests instead of creating one per parse.
+//!
+//! ```
+//! let pool = tree_sitter_hack::pool::ParserPool::new();
+//!
+//! let tree = pool.get().parse("<?hh\nfunction f(): void {}\n", None).unwrap();
+//! assert_eq!(tree.root_node().kind(), "script");
+//! ```
+//!
+//! Creating a parser allocates its stacks and lexer, and setting the language creates the external
+//! scanner. A pooled parser keeps all of that. When a [`PooledParser`] is dropped the parser is
+//! reset, which Tree-sitter does by deserializing the scanner from an empty state, so the next
+//! parse starts from scratch without creating a new scanner.
+//!
+//! The pool can be shared between threads, and every parser it hands out is only used by one
+//! thread at a time. That's all parsing needs: the generated tables in src/parser.c are constant,
+//! and src/scanner.c keeps its state in the scanner created for each parser, with no globals.
+//! `test_pool_parses_concurrently` in lib.rs checks this.
+
+use std::ops::{Deref, DerefMut};
+use std::sync::Mutex;
+use tree_sitter::Parser;
+
+/// A shared stack of idle parsers for this language.
+pub struct ParserPool {
+    parsers: Mutex<Vec<Parser>>,
+    max_idle: usize,
+}
+
+impl Default for ParserPool {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl ParserPool {
+    /// A pool that keeps up to 64 idle parsers.
+    pub fn new() -> Self {
+        Self::with_max_idle(64)
+    }
+
+    /// A pool that keeps up to `max_idle` idle parsers. Parsers returned to a full pool are
+    /// dropped, so a burst of requests doesn't keep its parsers forever.
+    pub fn with_max_idle(max_idle: usize) -> Self {
+        ParserPool {
+            parsers: Mutex::new(Vec::new()),
+            max_idle,
+        }
+    }
+
+    /// Check out an idle parser, or create one if there are none. It goes back to the pool when
+    /// the [`PooledParser`] is dropped.
+    pub fn get(&self) -> PooledParser<'_> {
+        let parser = self.parsers.lock().unwrap().pop().unwrap_or_else(|| {
+            let mut parser = Parser::new();
+            parser.set_language(crate::language()).unwrap();
+            parser
+        });
+
+        PooledParser {
+            parser: Some(parser),
+            pool: self,
+        }
+    }
+
+    /// The number of parsers waiting to be checked out.
+    pub fn idle(&self) -> usize {
+        self.parsers.lock().unwrap().len()
+    }
+}
+
+/// A parser checked out of a [`ParserPool`]. Dereferences to [`Parser`].
+///
+/// Set a timeout, cancellation flag, included ranges or logger freely: they're cleared when the
+/// parser is returned. Don't change the language, since every parser in the pool is expected to
+/// parse Hack.
+pub struct PooledParser<'pool> {
+    // Only `None` while dropping.
+    parser: Option<Parser>,
+    pool: &'pool ParserPool,
+}
+
+impl Deref for PooledParser<'_> {
+    type Target = Parser;
+
+    fn deref(&self) -> &Parser {
+        self.parser.as_ref().unwrap()
+    }
+}
+
+impl DerefMut for PooledParser<'_> {
+    fn deref_mut(&mut self) -> &mut Parser {
+        self.parser.as_mut().unwrap()
+    }
+}
+
+impl Drop for PooledParser<'_> {
+    fn drop(&mut self) {
+        let mut parser = self.parser.take().unwrap();
+
+        // A parse stopped by a timeout or cancellation would otherwise be resumed by the next
+        // user's first parse.
+        parser.reset();
+        parser.set_timeout_micros(0);
+        parser.set_included_ranges(&[]).unwrap();
+        parser.set_logger(None);
+        // Safety: clearing the flag can't leave a dangling pointer.
+        unsafe { parser.set_cancellation_flag(None) };
+
+        let mut parsers = self.pool.parsers.lock().unwrap();
+        if parsers.len() < self.pool.max_idle {
+            parsers.push(parser);
+        }
+    }
+}
@@ -0,0 +1,223 @@
+//! A compact binary format for shipping parse trees to consumers that don't run a parser.
+//!
+//! ```
+//! let mut parser = tree_sitter::Parser::new();
+//! parser.set_language(tree_sitter_hack::language()).unwrap();
+//! let tree = parser.parse("<?hh\nfoo();\n", None).unwrap();
+//!
+//! let bytes = tree_sitter_hack::serialize::serialize(&tree);
+//! let nodes = tree_sitter_hack::serialize::SerializedTree::new(&bytes).unwrap();
+//! assert_eq!(nodes.get(0).unwrap().symbol, tree.root_node().kind_id());
+//! ```
+//!
+//! The format is a header followed by one fixed-size record per node in preorder, so it can be
+//! memory mapped and scanned in place. All integers are little-endian.
+//!
+//! Header, [`HEADER_SIZE`] bytes:
+//!
+//! | Offset | Type      | Field                                       |
+//! |--------|-----------|---------------------------------------------|
+//! | 0      | `[u8; 4]` | [`MAGIC`]                                   |
+//! | 4      | `u16`     | Format [`VERSION`]                          |
+//! | 6      | `u16`     | Tree-sitter language ABI version            |
+//! | 8      | `u16`     | Symbol count of the grammar                 |
+//! | 10     | `u16`     | Field count of the grammar                  |
+//! | 12     | `u32`     | Number of nodes                             |
+//!
+//! Node, [`NODE_SIZE`] bytes:
+//!
+//! | Offset | Type  | Field                                                       |
+//! |--------|-------|-------------------------------------------------------------|
+//! | 0      | `u16` | Symbol, numbered like `ts_symbol_names` in `src/parser.c`   |
+//! | 2      | `u8`  | Field in the parent, like `ts_field_names`, 0 for none      |
+//! | 3      | `u8`  | [`flags`]                                                   |
+//! | 4      | `u32` | Start byte                                                  |
+//! | 8      | `u32` | End byte                                                    |
+//! | 12     | `u32` | Child count                                                 |
+//!
+//! Children directly follow their parent, so a node's subtree ends where its last child's does.
+//! ERROR nodes have symbol `u16::MAX`. Names for the numbers come from `src/node-types.json` or
+//! [`tree_sitter::Language::node_kind_for_id`] and [`tree_sitter::Language::field_name_for_id`].
+
+use std::convert::TryInto;
+use std::fmt;
+use tree_sitter::Tree;
+
+pub const MAGIC: [u8; 4] = *b"TSHK";
+pub const VERSION: u16 = 1;
+pub const HEADER_SIZE: usize = 16;
+pub const NODE_SIZE: usize = 16;
+
+/// Bits in [`SerializedNode::flags`].
+pub mod flags {
+    pub const NAMED: u8 = 1;
+    pub const MISSING: u8 = 2;
+    pub const EXTRA: u8 = 4;
+}
+
+/// Serialize every node of the tree, named or not.
+pub fn serialize(tree: &Tree) -> Vec<u8> {
+    let language = tree.language();
+    // Field ids are stored in a byte.
+    assert!(language.field_count() <= u8::MAX as usize);
+
+    let mut bytes = Vec::with_capacity(HEADER_SIZE + 64 * NODE_SIZE);
+    bytes.extend_from_slice(&MAGIC);
+    bytes.extend_from_slice(&VERSION.to_le_bytes());
+    bytes.extend_from_slice(&(language.version() as u16).to_le_bytes());
+    bytes.extend_from_slice(&(language.node_kind_count() as u16).to_le_bytes());
+    bytes.extend_from_slice(&(language.field_count() as u16).to_le_bytes());
+    // The node count is filled in at the end.
+    bytes.extend_from_slice(&0u32.to_le_bytes());
+
+    let mut count: u32 = 0;
+    let mut cursor = tree.walk();
+
+    loop {
+        let node = cursor.node();
+        let mut flags = 0;
+        if node.is_named() {
+            flags |= flags::NAMED;
+        }
+        if node.is_missing() {
+            flags |= flags::MISSING;
+        }
+        if node.is_extra() {
+            flags |= flags::EXTRA;
+        }
+
+        bytes.extend_from_slice(&node.kind_id().to_le_bytes());
+        bytes.push(cursor.field_id().unwrap_or(0) as u8);
+        bytes.push(flags);
+        bytes.extend_from_slice(&(node.start_byte() as u32).to_le_bytes());
+        bytes.extend_from_slice(&(node.end_byte() as u32).to_le_bytes());
+        bytes.extend_from_slice(&(node.child_count() as u32).to_le_bytes());
+        count += 1;
+
+        if cursor.goto_first_child() {
+            continue;
+        }
+
+        while !cursor.goto_next_sibling() {
+            if !cursor.goto_parent() {
+                bytes[12..16].copy_from_slice(&count.to_le_bytes());
+                return bytes;
+            }
+        }
+    }
+}
+
+/// A node record read back from [`serialize`] output.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct SerializedNode {
+    pub symbol: u16,
+    /// 0 if the node isn't in a field.
+    pub field: u8,
+    pub flags: u8,
+    pub start_byte: u32,
+    pub end_byte: u32,
+    pub child_count: u32,
+}
+
+/// Why [`SerializedTree::new`] rejected its input.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum FormatError {
+    BadMagic,
+    UnsupportedVersion(u16),
+    /// The input is shorter than the header says.
+    Truncated,
+}
+
+impl fmt::Display for FormatError {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        match self {
+            FormatError::BadMagic => write!(f, "not a serialized tree-sitter-hack tree"),
+            FormatError::UnsupportedVersion(version) => {
+                write!(f, "unsupported serialized tree version {}", version)
+            }
+            FormatError::Truncated => write!(f, "serialized tree is truncated"),
+        }
+    }
+}
+
+impl std::error::Error for FormatError {}
+
+/// Read access to [`serialize`] output without copying it, for example from a memory mapping.
+#[derive(Clone, Copy, Debug)]
+pub struct SerializedTree<'a> {
+    bytes: &'a [u8],
+}
+
+fn u16_at(bytes: &[u8], offset: usize) -> u16 {
+    u16::from_le_bytes(bytes[offset..offset + 2].try_into().unwrap())
+}
+
+fn u32_at(bytes: &[u8], offset: usize) -> u32 {
+    u32::from_le_bytes(bytes[offset..offset + 4].try_into().unwrap())
+}
+
+impl<'a> SerializedTree<'a> {
+    pub fn new(bytes: &'a [u8]) -> Result<Self, FormatError> {
+        if bytes.len() < HEADER_SIZE || bytes[0..4] != MAGIC {
+            return Err(FormatError::BadMagic);
+        }
+
+        let version = u16_at(bytes, 4);
+        if version != VERSION {
+            return Err(FormatError::UnsupportedVersion(version));
+        }
+
+        let tree = SerializedTree { bytes };
+        let nodes_size = tree.len().checked_mul(NODE_SIZE);
+        if nodes_size.map_or(true, |size| bytes.len() - HEADER_SIZE < size) {
+            return Err(FormatError::Truncated);
+        }
+
+        Ok(tree)
+    }
+
+    /// The Tree-sitter ABI version of the language the tree was parsed with.
+    pub fn language_version(&self) -> u16 {
+        u16_at(self.bytes, 6)
+    }
+
+    pub fn symbol_count(&self) -> u16 {
+        u16_at(self.bytes, 8)
+    }
+
+    pub fn field_count(&self) -> u16 {
+        u16_at(self.bytes, 10)
+    }
+
+    /// The number of nodes.
+    pub fn len(&self) -> usize {
+        u32_at(self.bytes, 12) as usize
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// The node at a preorder index. The root is at 0.
+    pub fn get(&self, index: usize) -> Option<SerializedNode> {
+        if index >= self.len() {
+            return None;
+        }
+
+        let offset = HEADER_SIZE + index * NODE_SIZE;
+        Some(SerializedNode {
+            symbol: u16_at(self.bytes, offset),
+            field: self.bytes[offset + 2],
+            flags: self.bytes[offset + 3],
+            start_byte: u32_at(self.bytes, offset + 4),
+            end_byte: u32_at(self.bytes, offset + 8),
+            child_count: u32_at(self.bytes, offset + 12),
+        })
+    }
+
+    /// All nodes in preorder.
+    pub fn nodes(&self) -> impl ExactSizeIterator<Item = SerializedNode> + 'a {
+        let tree = *self;
+        (0..self.len()).map(move |index| tree.get(index).unwrap())
+    }
+}
@@ -0,0 +1,198 @@
+//! Visit the top-level items of a file without building a tree for the whole file.
+//!
+//! ```no_run
+//! let mut parser = tree_sitter::Parser::new();
+//! parser.set_language(tree_sitter_hack::language()).unwrap();
+//!
+//! tree_sitter_hack::top_level::parse_file(&mut parser, "src/Generated.hack", |node, source| {
+//!     if let Some(name) = node.child_by_field_name("name") {
+//!         println!("{} {}", node.kind(), name.utf8_text(source).unwrap());
+//!     }
+//! })
+//! .unwrap();
+//! ```
+//!
+//! The source is split before every line that starts with a declaration keyword or an attribute,
+//! which is where hackfmt and most code generators put top-level items. Each part is parsed on its
+//! own with [`Parser::set_included_ranges`], so nodes keep their positions in the whole file, and
+//! its tree is dropped once its items have been visited. Peak memory is bounded by the largest
+//! part rather than the file.
+//!
+//! A split inside a heredoc, string or comment leaves the part's last item with a syntax error.
+//! The part is then reparsed together with the following parts until it parses cleanly, so items
+//! come out the same as they would from parsing the whole file, other than ERROR nodes caused by
+//! errors in other items.
+
+use memmap2::Mmap;
+use std::fs::File;
+use std::io;
+use std::path::Path;
+use tree_sitter::{Node, Parser, Point, Range};
+
+/// Keywords that start a top-level item when they begin a line.
+const ITEM_KEYWORDS: &[&[u8]] = &[
+    b"abstract",
+    b"async",
+    b"class",
+    b"const",
+    b"enum",
+    b"final",
+    b"function",
+    b"interface",
+    b"module",
+    b"namespace",
+    b"newtype",
+    b"trait",
+    b"type",
+    b"use",
+    b"xhp",
+];
+
+fn is_word_char(c: u8) -> bool {
+    c.is_ascii_alphanumeric() || c == b'_' || c >= 0x80
+}
+
+fn starts_item(line: &[u8]) -> bool {
+    if line.starts_with(b"<<") {
+        return true;
+    }
+
+    ITEM_KEYWORDS.iter().any(|keyword| {
+        line.starts_with(keyword) && line.get(keyword.len()).map_or(true, |&c| !is_word_char(c))
+    })
+}
+
+/// Where parts of the source start: byte offset and row. The last entry is the end of the source.
+fn split(source: &[u8]) -> Vec<(usize, Point)> {
+    let mut parts = vec![(0, Point::new(0, 0))];
+    let mut row = 0;
+    let mut line_start = 0;
+
+    for (i, &c) in source.iter().enumerate() {
+        if c == b'\n' {
+            row += 1;
+            line_start = i + 1;
+            if starts_item(&source[line_start..]) {
+                parts.push((line_start, Point::new(row, 0)));
+            }
+        }
+    }
+
+    parts.push((source.len(), Point::new(row, source.len() - line_start)));
+    parts
+}
+
+/// The `<?hh` line, which every part needs to parse like the rest of the file.
+fn header(source: &[u8]) -> Option<Range> {
+    if source.len() < 4 || !source[..4].eq_ignore_ascii_case(b"<?hh") {
+        return None;
+    }
+
+    let (end_byte, end_point) = match source.iter().position(|&c| c == b'\n') {
+        Some(newline) => (newline + 1, Point::new(1, 0)),
+        None => (source.len(), Point::new(0, source.len())),
+    };
+
+    Some(Range {
+        start_byte: 0,
+        end_byte,
+        start_point: Point::new(0, 0),
+        end_point,
+    })
+}
+
+// The last child that isn't a comment has a syntax error, so the part may have been split in the
+// middle of something.
+fn ends_in_error(root: Node) -> bool {
+    if root.is_error() {
+        return true;
+    }
+
+    let mut cursor = root.walk();
+    let last = root
+        .children(&mut cursor)
+        .filter(|child| !child.is_extra())
+        .last();
+    last.map_or(root.has_error(), |child| child.has_error())
+}
+
+/// Call `visit` with every named top-level node of `source` other than comments, in order. A
+/// braced namespace is visited as one node. Returns `false` if the parser's timeout or
+/// cancellation flag stopped a parse, after resetting the parser.
+///
+/// Restores the parser's included ranges to the whole document before returning.
+pub fn parse(parser: &mut Parser, source: &[u8], mut visit: impl FnMut(Node, &[u8])) -> bool {
+    let parts = split(source);
+    let header = header(source);
+    let last = parts.len() - 1;
+    let mut start = 0;
+
+    while start < last {
+        let mut end = start + 1;
+
+        let tree = loop {
+            let (start_byte, start_point) = parts[start];
+            let (end_byte, end_point) = parts[end];
+            let part = Range {
+                start_byte,
+                end_byte,
+                start_point,
+                end_point,
+            };
+
+            let ranges = match header {
+                Some(header) if start_byte >= header.end_byte => vec![header, part],
+                _ => vec![part],
+            };
+            parser.set_included_ranges(&ranges).unwrap();
+
+            let tree = match parser.parse(source, None) {
+                Some(tree) => tree,
+                None => {
+                    parser.reset();
+                    parser.set_included_ranges(&[]).unwrap();
+                    return false;
+                }
+            };
+
+            if end == last || !ends_in_error(tree.root_node()) {
+                break tree;
+            }
+
+            // Doubling keeps a file with a real error near the start from being reparsed once
+            // per part.
+            end = last.min(end + (end - start));
+        };
+
+        let root = tree.root_node();
+        let mut cursor = root.walk();
+        for node in root.named_children(&mut cursor) {
+            if !node.is_extra() {
+                visit(node, source);
+            }
+        }
+
+        start = end;
+    }
+
+    parser.set_included_ranges(&[]).unwrap();
+    true
+}
+
+/// [`parse`] a memory mapped file.
+pub fn parse_file(
+    parser: &mut Parser,
+    path: impl AsRef<Path>,
+    visit: impl FnMut(Node, &[u8]),
+) -> io::Result<bool> {
+    let file = File::open(path)?;
+
+    // Mapping an empty file fails on some platforms.
+    if file.metadata()?.len() == 0 {
+        return Ok(parse(parser, &[], visit));
+    }
+
+    // Safety: the mapping is only read, see file::FileParser.
+    let source = unsafe { Mmap::map(&file)? };
+    Ok(parse(parser, &source[..], visit))
+}
@@ -1,3 +1,8 @@
+; Editors rerun this query over the visible range on every keystroke, see bench/highlight.c. Keep
+; every pattern a single node kind with no predicates, so a range-restricted cursor only looks at
+; nodes in range instead of matching parents that start outside it. Captures are numbered in the
+; order they first appear, see `highlights` in bindings/rust/lib.rs.
+
 (comment) @comment
 
 (string) @string
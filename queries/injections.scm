@@ -0,0 +1,17 @@
+; Heredocs and nowdocs are injected by their delimiter: <<<SQL, <<<'JSON', <<<"GRAPHQL" and so
+; on. The body is a hidden token from the external scanner, so the content is the whole heredoc
+; with its variables and embedded expressions left out. To parse only the body on the same buffer,
+; use the ranges from `injections::heredocs` in bindings/rust/injections.rs, which also drop the
+; delimiter lines.
+
+((heredoc) @injection.content
+  (#match? @injection.content "^<<<[ \t]*['\"]?SQL\\b")
+  (#set! injection.language "sql"))
+
+((heredoc) @injection.content
+  (#match? @injection.content "^<<<[ \t]*['\"]?JSON\\b")
+  (#set! injection.language "json"))
+
+((heredoc) @injection.content
+  (#match? @injection.content "^<<<[ \t]*['\"]?GRAPHQL\\b")
+  (#set! injection.language "graphql"))
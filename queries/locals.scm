@@ -0,0 +1,37 @@
+; Hack variables are function scoped. Blocks don't introduce a scope.
+
+(function_declaration) @local.scope
+(method_declaration) @local.scope
+(anonymous_function_expression) @local.scope
+(lambda_expression) @local.scope
+
+; Definitions
+
+(parameter
+  name: (variable) @local.definition)
+
+(binary_expression
+  left: (variable) @local.definition
+  operator: "=")
+
+(binary_expression
+  left: (list_expression
+    (variable) @local.definition)
+  operator: "=")
+
+(foreach_statement
+  key: (variable) @local.definition)
+
+(foreach_statement
+  value: (variable) @local.definition)
+
+(foreach_statement
+  value: (list_expression
+    (variable) @local.definition))
+
+(catch_clause
+  name: (variable) @local.definition)
+
+; References
+
+(variable) @local.reference
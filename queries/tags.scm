@@ -0,0 +1,75 @@
+; Every pattern starts at a declaration or call node and reaches its name through a field or an
+; anchor so the query cursor never has to try a pattern against unrelated nodes.
+
+; Definitions
+
+(class_declaration
+  name: [(identifier) (xhp_class_identifier) (xhp_identifier)] @name) @definition.class
+
+(interface_declaration
+  name: (identifier) @name) @definition.interface
+
+(trait_declaration
+  name: (identifier) @name) @definition.interface
+
+(enum_declaration
+  name: (identifier) @name) @definition.enum
+
+(enum_class_declaration
+  name: (identifier) @name) @definition.enum
+
+(function_declaration
+  name: (identifier) @name) @definition.function
+
+(method_declaration
+  name: (identifier) @name) @definition.method
+
+; alias_declaration has no name field. The name is the first identifier, after any attributes.
+
+(alias_declaration
+  .
+  (identifier) @name) @definition.type
+
+(alias_declaration
+  (attribute_modifier)
+  .
+  (identifier) @name) @definition.type
+
+(namespace_declaration
+  name: (qualified_identifier) @name) @definition.module
+
+; Top-level and class constants. Class constants are aliased to const_declarator too.
+
+(const_declarator
+  name: (identifier) @name) @definition.constant
+
+; References
+
+(call_expression
+  function: (qualified_identifier
+    (identifier) @name .)) @reference.call
+
+(call_expression
+  function: (scoped_identifier
+    (identifier) @name .)) @reference.call
+
+(call_expression
+  function: (selection_expression
+    (qualified_identifier
+      (identifier) @name .) .)) @reference.call
+
+(new_expression
+  .
+  [
+    (qualified_identifier
+      (identifier) @name .)
+    (xhp_class_identifier) @name
+  ]) @reference.class
+
+(xhp_open
+  .
+  [(xhp_identifier) (xhp_class_identifier)] @name) @reference.class
+
+(xhp_open_close
+  .
+  [(xhp_identifier) (xhp_class_identifier)] @name) @reference.class
@@ -0,0 +1,76 @@
+/**
+ * Instrumentation build of the generated parser, see instrument.h. Replaces src/parser.c in the
+ * build: the lexer macros from tree_sitter/parser.h are redefined to count lex state hits before
+ * the generated parser is included, so parser.c itself stays untouched by bin/generate-parser.
+ */
+
+#include <string.h>
+#include <tree_sitter/parser.h>
+
+#include "instrument.h"
+
+#define increment(counter, value) __atomic_fetch_add(&(counter), (value), __ATOMIC_RELAXED)
+
+// Every state TSStateId can hold, so there is no bounds check on the lexer hot path.
+#define LEX_STATE_CAP (UINT16_MAX + 1)
+
+static TreeSitterHackStats stats;
+static uint64_t lex_states[2][LEX_STATE_CAP];
+
+// ts_lex and ts_lex_keywords both expand START_LEXER, tell them apart by their name.
+#define IS_KEYWORD_LEXER (sizeof(__func__) == sizeof("ts_lex_keywords"))
+
+#undef START_LEXER
+#define START_LEXER()                                                              \
+  bool result = false;                                                             \
+  bool skip = false;                                                               \
+  bool eof = false;                                                                \
+  int32_t lookahead;                                                               \
+  increment(*(IS_KEYWORD_LEXER ? &stats.keyword_lex_calls : &stats.lex_calls), 1); \
+  goto start;                                                                      \
+  next_state:                                                                      \
+  lexer->advance(lexer, skip);                                                     \
+  start:                                                                           \
+  increment(lex_states[IS_KEYWORD_LEXER][state], 1);                               \
+  skip = false;                                                                    \
+  lookahead = lexer->lookahead;
+
+#include "parser.c"
+
+void tree_sitter_hack_instrument_scan(
+    TreeSitterHackScanFunction function,
+    uint64_t advances,
+    bool result) {
+  TreeSitterHackScanCounters *counters = &stats.functions[function];
+  increment(counters->calls, 1);
+  increment(counters->advances, advances);
+  if (!result) increment(counters->failures, 1);
+}
+
+void tree_sitter_hack_instrument_external_scan(uint64_t advances, bool result) {
+  increment(stats.scans, 1);
+  if (!result && advances > 0) {
+    increment(stats.rollbacks, 1);
+    increment(stats.rollback_advances, advances);
+  }
+}
+
+void tree_sitter_hack_instrument_stats(TreeSitterHackStats *copy) {
+  uint64_t *from = (uint64_t *)&stats, *to = (uint64_t *)copy;
+  for (size_t i = 0; i < sizeof(stats) / sizeof(uint64_t); i++) {
+    to[i] = __atomic_load_n(&from[i], __ATOMIC_RELAXED);
+  }
+}
+
+const uint64_t *tree_sitter_hack_instrument_lex_states(bool keywords, uint32_t *count) {
+  const uint64_t *states = lex_states[keywords];
+  uint32_t length = LEX_STATE_CAP;
+  while (length > 0 && __atomic_load_n(&states[length - 1], __ATOMIC_RELAXED) == 0) length--;
+  *count = length;
+  return states;
+}
+
+void tree_sitter_hack_instrument_reset(void) {
+  memset(&stats, 0, sizeof(stats));
+  memset(lex_states, 0, sizeof(lex_states));
+}
@@ -0,0 +1,70 @@
+#ifndef TREE_SITTER_HACK_INSTRUMENT_H_
+#define TREE_SITTER_HACK_INSTRUMENT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Hot path counters for the instrumentation build. Compile src/instrument.c instead of
+ * src/parser.c and define TREE_SITTER_HACK_INSTRUMENT for src/scanner.c:
+ *
+ *     $ node-gyp rebuild --instrument=true
+ *     $ cargo build --features instrument
+ *
+ * Counters are global, shared by every parser in the process and updated with relaxed atomics so
+ * concurrent parses don't lose counts. Regular builds don't contain any of these symbols.
+ */
+
+typedef enum {
+  TREE_SITTER_HACK_SCAN_START,
+  TREE_SITTER_HACK_SCAN_BODY,
+  TREE_SITTER_HACK_SCAN_DELIMITER,
+  TREE_SITTER_HACK_SCAN_FUNCTION_COUNT,
+} TreeSitterHackScanFunction;
+
+typedef struct {
+  uint64_t calls;
+  // Characters advanced over, including skipped ones. scan_body includes the characters of the
+  // delimiter checks it makes.
+  uint64_t advances;
+  uint64_t failures;
+} TreeSitterHackScanCounters;
+
+typedef struct {
+  // Calls to tree_sitter_hack_external_scanner_scan.
+  uint64_t scans;
+  // Scans that advanced and then returned false. Tree-sitter throws their work away and lexes the
+  // same characters again with the internal lexer.
+  uint64_t rollbacks;
+  uint64_t rollback_advances;
+  TreeSitterHackScanCounters functions[TREE_SITTER_HACK_SCAN_FUNCTION_COUNT];
+  // Calls to ts_lex and ts_lex_keywords from the generated parser.
+  uint64_t lex_calls;
+  uint64_t keyword_lex_calls;
+} TreeSitterHackStats;
+
+// Copy the current counters into stats.
+void tree_sitter_hack_instrument_stats(TreeSitterHackStats *stats);
+
+// Number of times each lex state was entered, indexed by state. Stores the number of states up to
+// and including the highest one entered so far in count. Use keywords for ts_lex_keywords.
+const uint64_t *tree_sitter_hack_instrument_lex_states(bool keywords, uint32_t *count);
+
+void tree_sitter_hack_instrument_reset(void);
+
+// Used by src/scanner.c.
+void tree_sitter_hack_instrument_scan(
+    TreeSitterHackScanFunction function,
+    uint64_t advances,
+    bool result);
+void tree_sitter_hack_instrument_external_scan(uint64_t advances, bool result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // TREE_SITTER_HACK_INSTRUMENT_H_
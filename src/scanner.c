@@ -1,9 +1,12 @@
-#include <assert.h>
 #include <stdio.h>
 #include <string.h>
 #include <tree_sitter/parser.h>
 #include <wctype.h>
 
+#ifdef TREE_SITTER_HACK_INSTRUMENT
+#include "instrument.h"
+#endif
+
 /**
  * Debugging helper macros. Example output:
  *
@@ -41,6 +44,7 @@
   {                               \
     endline chr = str(peek());    \
     print("next %s\n", chr.str);  \
+    instrument_advance();         \
     lexer->advance(lexer, false); \
   }
 
@@ -48,6 +52,7 @@
   {                              \
     endline chr = str(peek());   \
     print("skip %s\n", chr.str); \
+    instrument_advance();        \
     lexer->advance(lexer, true); \
   }
 
@@ -66,9 +71,29 @@
 
 #define ret(function, result)                                   \
   print("%s() -> %s\n", function, (result) ? "true" : "false"); \
+  instrument_end(result);                                       \
   return result;
 
-#define MAX(a, b) ((a) > (b) ? (a) : (b))
+/**
+ * Instrumentation build hooks, see instrument.h. A scan function records its entry with
+ * instrument_begin and ret() reports the call with the number of characters advanced since.
+ */
+
+#ifdef TREE_SITTER_HACK_INSTRUMENT
+#define instrument_begin(function)                                 \
+  const TreeSitterHackScanFunction instrument_function = function; \
+  const uint64_t instrument_advances = scanner->advances
+
+#define instrument_advance() scanner->advances++
+
+#define instrument_end(result)      \
+  tree_sitter_hack_instrument_scan( \
+      instrument_function, scanner->advances - instrument_advances, result)
+#else
+#define instrument_begin(function)
+#define instrument_advance()
+#define instrument_end(result)
+#endif
 
 enum TokenType {
   HEREDOC_START,
@@ -88,44 +113,28 @@ const char *const TokenTypes[] = {
     [EMBEDDED_OPENING_BRACE] = "EMBEDDED_OPENING_BRACE",  //
 };
 
+// The delimiter is serialized after the is_nowdoc, did_start and did_end flags so it has to fit in
+// the remainder of the serialization buffer. Storing it inline means the scanner never allocates
+// after creation.
+#define STRING_CAP (TREE_SITTER_SERIALIZATION_BUFFER_SIZE - 3)
+
 typedef struct {
-  uint32_t cap;
   uint32_t len;
-  char *data;
+  char data[STRING_CAP + 1];  // Nul terminated for debug output.
 } String;
 
-static String string_new() { return (String){.cap = 16, .len = 0, .data = calloc(1, 17)}; }
-
-static void string_resize(String *string, uint32_t cap) {
-  void *tmp = realloc(string->data, (cap + 1));
-  assert(tmp != NULL);
-  string->data = tmp;
-  memset(string->data + string->len, 0, ((cap + 1) - string->len));
-  string->cap = cap;
-}
-
-static void string_grow(String *string, uint32_t cap) {
-  if (string->cap < cap) {
-    string_resize(string, cap);
-  }
-}
-
-static void string_push(String *string, char chr) {
-  if (string->cap == string->len) {
-    string_resize(string, MAX(16, string->len * 2));
+static bool string_push(String *string, char chr) {
+  if (string->len == STRING_CAP) {
+    return false;
   }
   string->data[string->len++] = chr;
-}
-
-static void string_free(String *string) {
-  if (string->data != NULL) {
-    free(string->data);
-  }
+  string->data[string->len] = '\0';
+  return true;
 }
 
 static void string_clear(String *string) {
   string->len = 0;
-  memset(string->data, 0, string->cap);
+  string->data[0] = '\0';
 }
 
 typedef struct {
@@ -133,6 +142,9 @@ typedef struct {
   bool is_nowdoc;
   bool did_start;
   bool did_end;
+#ifdef TREE_SITTER_HACK_INSTRUMENT
+  uint64_t advances;
+#endif
 } Scanner;
 
 typedef struct {
@@ -161,7 +173,9 @@ static endline str(int32_t chr) {
 }
 
 static unsigned serialize(Scanner *scanner, char *buffer) {
-  if (scanner->delimiter.len + 2 >= TREE_SITTER_SERIALIZATION_BUFFER_SIZE) {
+  // Outside of a heredoc there is no state worth saving. An empty state lets deserialize take its
+  // fast path and lets Tree-sitter compare external scanner states without a memcmp.
+  if (scanner->delimiter.len == 0) {
     return 0;
   }
   buffer[0] = (char)scanner->is_nowdoc;
@@ -173,17 +187,16 @@ static unsigned serialize(Scanner *scanner, char *buffer) {
 
 static void deserialize(Scanner *scanner, const char *buffer, unsigned length) {
   if (length == 0) {
-    scanner->is_nowdoc = false;
-    scanner->did_start = false;
-    scanner->did_end = false;
-    string_clear(&scanner->delimiter);
+    // Not inside a heredoc. The flags are only read while there is a delimiter and scan_start
+    // resets them, so clearing the delimiter length is enough.
+    scanner->delimiter.len = 0;
   } else {
     scanner->is_nowdoc = buffer[0];
     scanner->did_start = buffer[1];
     scanner->did_end = buffer[2];
     scanner->delimiter.len = length - 3;
-    string_grow(&scanner->delimiter, scanner->delimiter.len);
     memcpy(scanner->delimiter.data, &buffer[3], scanner->delimiter.len);
+    scanner->delimiter.data[scanner->delimiter.len] = '\0';
   }
 }
 
@@ -193,8 +206,26 @@ static inline bool is_identifier_start_char(int32_t chr) {
          (128 <= chr && chr <= 255);
 }
 
+// The isw* functions go through the C library's locale tables on every call. Code and delimiters
+// are almost always ASCII, so only ask the C library about other characters.
+static inline bool is_space(int32_t chr) {
+  if (chr < 128) return chr == ' ' || ('\t' <= chr && chr <= '\r');
+  return iswspace(chr);
+}
+
+static inline bool is_delimiter_start_char(int32_t chr) {
+  if (chr < 128) return chr == '_' || ('a' <= chr && chr <= 'z') || ('A' <= chr && chr <= 'Z');
+  return iswalpha(chr);
+}
+
+static inline bool is_delimiter_char(int32_t chr) {
+  if (chr < 128) return is_delimiter_start_char(chr) || ('0' <= chr && chr <= '9');
+  return iswalnum(chr);
+}
+
 static bool scan_delimiter(Scanner *scanner, TSLexer *lexer) {
   print("scan_delimiter() <-\n");
+  instrument_begin(TREE_SITTER_HACK_SCAN_DELIMITER);
   for (unsigned long index = 0; index < scanner->delimiter.len; index++) {
     if (scanner->delimiter.data[index] == peek()) {
       next();
@@ -205,14 +236,57 @@ static bool scan_delimiter(Scanner *scanner, TSLexer *lexer) {
   ret("scan_delimiter", true);
 }
 
+// Returns false for characters that may end a HEREDOC_BODY token or start an embedded expression.
+// Nowdocs have no embedded expressions so only newlines, escapes and the end of input matter.
+static inline bool is_text_char(int32_t chr, bool is_nowdoc) {
+  switch (chr) {
+    case '\0':
+    case '\\':
+    case '\n':
+      return false;
+    case '{':
+    case '$':
+      return is_nowdoc;
+    default:
+      return true;
+  }
+}
+
+// Advance over a run of plain body text and return whether anything was consumed. Large embedded
+// SQL and JSON heredocs are mostly plain text so this is where scan_body spends its time.
+static bool scan_text(Scanner *scanner, TSLexer *lexer) {
+  bool is_nowdoc = scanner->is_nowdoc;
+  void (*advance)(TSLexer *, bool) = lexer->advance;
+
+  if (!is_text_char(peek(), is_nowdoc)) {
+    return false;
+  }
+
+  print("text ");
+  do {
+    print("%s", str(peek()).str);
+    instrument_advance();
+    advance(lexer, false);
+  } while (is_text_char(peek(), is_nowdoc));
+  print("\n");
+
+  return true;
+}
+
 static bool scan_body(Scanner *scanner, TSLexer *lexer) {
   print("scan_body() <-\n");
+  instrument_begin(TREE_SITTER_HACK_SCAN_BODY);
 
   bool did_advance = false;
 
   for (;;) {
+    // Once did_end is set every character has to go through the delimiter check below.
+    if (!scanner->did_end && scan_text(scanner, lexer)) {
+      did_advance = true;
+    }
+
     if (peek() == '\0') {
-      return false;
+      ret("scan_body", false);
     }
 
     if (peek() == '\\') {
@@ -330,10 +404,13 @@ static bool scan_body(Scanner *scanner, TSLexer *lexer) {
 
 static bool scan_start(Scanner *scanner, TSLexer *lexer) {
   print("scan_start() <-\n");
+  instrument_begin(TREE_SITTER_HACK_SCAN_START);
 
-  while (iswspace(peek())) skip();
+  while (is_space(peek())) skip();
 
   scanner->is_nowdoc = peek() == '\'';
+  scanner->did_start = false;
+  scanner->did_end = false;
   string_clear(&scanner->delimiter);
 
   int32_t quote = 0;
@@ -342,12 +419,15 @@ static bool scan_start(Scanner *scanner, TSLexer *lexer) {
     next();
   }
 
-  if (iswalpha(peek()) || peek() == '_') {
+  if (is_delimiter_start_char(peek())) {
     string_push(&scanner->delimiter, peek());
     next();
 
-    while (iswalnum(peek()) || peek() == '_') {
-      string_push(&scanner->delimiter, peek());
+    while (is_delimiter_char(peek())) {
+      // Delimiters too long to serialize can't be tracked across scans.
+      if (!string_push(&scanner->delimiter, peek())) {
+        ret("scan_start", false);
+      }
       next();
     }
   }
@@ -363,7 +443,7 @@ static bool scan_start(Scanner *scanner, TSLexer *lexer) {
 
   // A valid delimiter must end with a newline with no whitespace in between.
   if (peek() != '\n' || scanner->delimiter.len == 0) {
-    return false;
+    ret("scan_start", false);
   }
 
   set(HEREDOC_START);
@@ -420,15 +500,22 @@ static bool scan(Scanner *scanner, TSLexer *lexer, const bool *expected) {
   return false;
 }
 
-void *tree_sitter_hack_external_scanner_create() {
-  Scanner *scanner = calloc(1, sizeof(Scanner));
-  scanner->delimiter = string_new();
-  return scanner;
-}
+// Every bit of scanner state is in the payload, one per parser, and the globals above are
+// constant, so parsers on different threads never share anything mutable. ts_parser_reset
+// deserializes an empty state, which is all a pooled parser needs before its next parse, see
+// bindings/rust/pool.rs.
+void *tree_sitter_hack_external_scanner_create() { return calloc(1, sizeof(Scanner)); }
 
 bool tree_sitter_hack_external_scanner_scan(void *payload, TSLexer *lexer, const bool *expected) {
   Scanner *scanner = (Scanner *)payload;
+#ifdef TREE_SITTER_HACK_INSTRUMENT
+  uint64_t advances = scanner->advances;
+  bool result = scan(scanner, lexer, expected);
+  tree_sitter_hack_instrument_external_scan(scanner->advances - advances, result);
+  return result;
+#else
   return scan(scanner, lexer, expected);
+#endif
 }
 
 unsigned tree_sitter_hack_external_scanner_serialize(void *payload, char *state) {
@@ -443,7 +530,5 @@ void tree_sitter_hack_external_scanner_deserialize(
 }
 
 void tree_sitter_hack_external_scanner_destroy(void *payload) {
-  Scanner *scanner = (Scanner *)payload;
-  string_free(&scanner->delimiter);
-  free(scanner);
+  free(payload);
 }
@@ -0,0 +1,97 @@
+/**
+ * Run the test/corpus suite against the wasm build with web-tree-sitter, like `tree-sitter test`
+ * does against the native one. See bin/test-wasm.
+ *
+ *     $ node test/wasm.js tree-sitter-hack.wasm
+ */
+
+const fs = require('fs');
+const path = require('path');
+const Parser = require('web-tree-sitter');
+
+const corpusDir = path.join(__dirname, 'corpus');
+
+// The corpus format as `tree-sitter test` reads it in Tree-sitter v0.20.6, from cli/src/test.rs,
+// so this passes and fails on exactly the same tests as the native suite.
+const headerRegex = /^===+\r?\n([^=]*)\r?\n===+\r?\n/gm;
+const dividerRegex = /^---+\r?\n/gm;
+const whitespaceRegex = /\s+/g;
+const sexpFieldRegex = / \w+: \(/g;
+
+// Each test is a name between two ===== lines, the input, the longest line of dashes and the
+// expected tree.
+function tests(file) {
+  const text = fs.readFileSync(file, 'utf8');
+  const headers = [...text.matchAll(headerRegex)];
+
+  return headers.flatMap((header, i) => {
+    const start = header.index + header[0].length;
+    const end = i + 1 < headers.length ? headers[i + 1].index : text.length;
+    const body = text.slice(start, end);
+
+    let divider = null;
+    for (const match of body.matchAll(dividerRegex)) {
+      if (divider === null || match[0].length >= divider[0].length) divider = match;
+    }
+    if (divider === null) return [];
+
+    // Only one newline is removed from the input, so blank lines before the divider are kept.
+    const input = body.slice(0, divider.index).replace(/\r?\n$/, '');
+    const output = body
+      .slice(divider.index + divider[0].length)
+      .trim()
+      .replace(whitespaceRegex, ' ')
+      .replace(/ \)/g, ')');
+
+    return [
+      {
+        name: header[1].trim(),
+        input,
+        output,
+        // Fields are only compared if the expected tree has some.
+        hasFields: output.search(sexpFieldRegex) !== -1,
+      },
+    ];
+  });
+}
+
+async function main() {
+  const wasm = process.argv[2] || 'tree-sitter-hack.wasm';
+
+  await Parser.init();
+  const parser = new Parser();
+  parser.setLanguage(await Parser.Language.load(fs.readFileSync(wasm)));
+
+  let failures = 0;
+  let count = 0;
+
+  for (const file of fs.readdirSync(corpusDir).sort()) {
+    if (!file.endsWith('.txt')) continue;
+    console.log(`${path.basename(file, '.txt')}:`);
+
+    for (const { name, input, output, hasFields } of tests(path.join(corpusDir, file))) {
+      const tree = parser.parse(input);
+      let actual = tree.rootNode.toString();
+      tree.delete();
+      if (!hasFields) actual = actual.replace(sexpFieldRegex, ' (');
+      count++;
+
+      if (actual === output) {
+        console.log(`  ✓ ${name}`);
+      } else {
+        failures++;
+        console.log(`  ✗ ${name}`);
+        console.log(`    expected: ${output}`);
+        console.log(`    actual:   ${actual}`);
+      }
+    }
+  }
+
+  console.log(`\n${count - failures} of ${count} tests passed`);
+  if (failures > 0) process.exit(1);
+}
+
+main().catch(error => {
+  console.error(error);
+  process.exit(1);
+});
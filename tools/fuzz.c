@@ -0,0 +1,147 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <tree_sitter/api.h>
+
+#include "instrument.h"
+#include "read_file.h"
+
+/**
+ * Fuzz target for src/parser.c and src/scanner.c, see bin/fuzz. Besides crashes and sanitizer
+ * reports, an input fails if parsing it does more work than its size allows, so inputs that make
+ * scan_body, scan_delimiter or error recovery super-linear are found as well:
+ *
+ *   - external scanner characters advanced, including scans Tree-sitter rolls back, over
+ *     TREE_SITTER_HACK_FUZZ_ADVANCES_PER_BYTE (default 64) per byte
+ *   - calls to ts_lex and ts_lex_keywords over TREE_SITTER_HACK_FUZZ_LEX_CALLS_PER_BYTE (default
+ *     16) per byte
+ *   - parse time over TREE_SITTER_HACK_FUZZ_NS_PER_BYTE (default 20000ns) per byte, unless it's 0
+ *
+ * The counters come from the instrumentation build (see src/instrument.h) and don't depend on the
+ * machine, so they are the reliable checks. The time limit covers the parser's own work, like
+ * error recovery on the parse stack, which the counters don't see. It's set as the parser's
+ * timeout, so it's generous enough for sanitizer builds, but it still depends on the machine's
+ * load: bin/fuzz --replay turns it off unless the variable is set. Inputs under 1KB count as 1KB,
+ * like bin/ts-errors --slowest, so fixed per-parse costs don't fail tiny inputs.
+ *
+ * Build with -DTREE_SITTER_HACK_LIBFUZZER and -fsanitize=fuzzer for libFuzzer. Otherwise there's a
+ * main that runs every file given as an argument, for AFL (`afl-fuzz ... -- fuzz @@`) and for
+ * replaying crashes and seeds.
+ */
+
+const TSLanguage *tree_sitter_hack(void);
+
+static uint64_t advances_per_byte, lex_calls_per_byte, ns_per_byte;
+static TSParser *parser;
+// The file being run by main, for failure messages.
+static const char *input_path;
+
+static uint64_t getenv_u64(const char *name, uint64_t fallback) {
+  const char *value = getenv(name);
+  return value != NULL && value[0] != '\0' ? strtoull(value, NULL, 10) : fallback;
+}
+
+static void init() {
+  advances_per_byte = getenv_u64("TREE_SITTER_HACK_FUZZ_ADVANCES_PER_BYTE", 64);
+  lex_calls_per_byte = getenv_u64("TREE_SITTER_HACK_FUZZ_LEX_CALLS_PER_BYTE", 16);
+  ns_per_byte = getenv_u64("TREE_SITTER_HACK_FUZZ_NS_PER_BYTE", 20000);
+
+  parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_hack());
+}
+
+static uint64_t scanner_advances(const TreeSitterHackStats *stats) {
+  uint64_t advances = 0;
+  for (unsigned i = 0; i < TREE_SITTER_HACK_SCAN_FUNCTION_COUNT; i++) {
+    advances += stats->functions[i].advances;
+  }
+  return advances;
+}
+
+static uint64_t budgeted_bytes(size_t size) {
+  return size < 1024 ? 1024 : size;
+}
+
+static void fail(const char *what, uint64_t value, uint64_t per_byte, size_t size) {
+  if (input_path != NULL) fprintf(stderr, "%s: ", input_path);
+  fprintf(
+      stderr,
+      "%s: %" PRIu64 " for %zu bytes, %.1f per byte, budget %" PRIu64 " per byte\n",
+      what,
+      value,
+      size,
+      (double)value / budgeted_bytes(size),
+      per_byte);
+  abort();
+}
+
+static void check(const char *what, uint64_t value, uint64_t per_byte, size_t size) {
+  if (value > per_byte * budgeted_bytes(size)) fail(what, value, per_byte, size);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  if (parser == NULL) init();
+  if (size > UINT32_MAX) return 0;
+
+  // A timeout of 0 is none.
+  ts_parser_set_timeout_micros(parser, (ns_per_byte * budgeted_bytes(size) + 999) / 1000);
+
+  // Counters are only read, not reset: with a diff there's no need to clear the lex state table.
+  TreeSitterHackStats before, after;
+  tree_sitter_hack_instrument_stats(&before);
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  TSTree *tree = ts_parser_parse_string(parser, NULL, (const char *)data, size);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  tree_sitter_hack_instrument_stats(&after);
+
+  // The parser gave up at its timeout.
+  if (tree == NULL) {
+    uint64_t ns = (end.tv_sec - start.tv_sec) * 1000000000 + (end.tv_nsec - start.tv_nsec);
+    fail("parse ns", ns, ns_per_byte, size);
+  }
+  ts_tree_delete(tree);
+
+  check(
+      "scanner advances",
+      scanner_advances(&after) - scanner_advances(&before),
+      advances_per_byte,
+      size);
+  check(
+      "lex calls",
+      after.lex_calls + after.keyword_lex_calls - before.lex_calls - before.keyword_lex_calls,
+      lex_calls_per_byte,
+      size);
+
+  return 0;
+}
+
+#ifndef TREE_SITTER_HACK_LIBFUZZER
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: fuzz FILE...\n");
+    return 1;
+  }
+
+  for (int i = 1; i < argc; i++) {
+    uint32_t length;
+    char *data = read_file(argv[i], &length);
+    if (data == NULL) {
+      fprintf(stderr, "Could not read %s: %s\n", argv[i], strerror(errno));
+      return 1;
+    }
+
+    input_path = argv[i];
+    LLVMFuzzerTestOneInput((const uint8_t *)data, length);
+    free(data);
+  }
+
+  return 0;
+}
+#endif
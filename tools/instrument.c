@@ -0,0 +1,129 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tree_sitter/api.h>
+
+#include "instrument.h"
+#include "read_file.h"
+
+/**
+ * Parse files with the instrumentation build and report where the lexers spend their time. Reads
+ * file paths from stdin (one per line):
+ *
+ *     $ fd '\.(hack|php)$' examples/hack-sql-fake | bin/instrument --top 10
+ *
+ * Prints calls, characters advanced and failures for each external scanner function, scans rolled
+ * back by Tree-sitter and the most entered states of ts_lex and ts_lex_keywords.
+ */
+
+const TSLanguage *tree_sitter_hack(void);
+
+typedef struct {
+  uint32_t state;
+  uint64_t hits;
+} StateHits;
+
+static int compare_hits(const void *a, const void *b) {
+  uint64_t x = ((const StateHits *)a)->hits, y = ((const StateHits *)b)->hits;
+  return (x < y) - (x > y);
+}
+
+static void print_lex_states(const char *name, bool keywords, uint64_t calls, unsigned top) {
+  uint32_t count;
+  const uint64_t *hits = tree_sitter_hack_instrument_lex_states(keywords, &count);
+
+  StateHits *states = malloc((count > 0 ? count : 1) * sizeof(StateHits));
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    states[i] = (StateHits){i, hits[i]};
+    total += hits[i];
+  }
+  qsort(states, count, sizeof(StateHits), compare_hits);
+
+  printf("\n%s: %" PRIu64 " calls, %" PRIu64 " state hits\n", name, calls, total);
+  printf("%8s %14s %8s\n", "state", "hits", "share");
+  for (uint32_t i = 0; i < count && i < top && states[i].hits > 0; i++) {
+    printf(
+        "%8u %14" PRIu64 " %7.2f%%\n",
+        states[i].state,
+        states[i].hits,
+        total > 0 ? states[i].hits * 100.0 / total : 0);
+  }
+
+  free(states);
+}
+
+static void usage() {
+  fprintf(stderr, "usage: instrument [--top N] < paths\n");
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  unsigned top = 20;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+      top = atoi(argv[++i]);
+    } else {
+      usage();
+    }
+  }
+
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_hack());
+
+  uint64_t files = 0, bytes = 0;
+
+  char path[4096];
+  while (fgets(path, sizeof(path), stdin) != NULL) {
+    path[strcspn(path, "\n")] = '\0';
+    if (path[0] == '\0') continue;
+
+    uint32_t length;
+    char *source = read_file(path, &length);
+    if (source == NULL) {
+      fprintf(stderr, "Could not read %s: %s\n", path, strerror(errno));
+      continue;
+    }
+
+    ts_tree_delete(ts_parser_parse_string(parser, NULL, source, length));
+    files++;
+    bytes += length;
+    free(source);
+  }
+
+  ts_parser_delete(parser);
+
+  TreeSitterHackStats stats;
+  tree_sitter_hack_instrument_stats(&stats);
+
+  static const char *const functions[] = {
+      [TREE_SITTER_HACK_SCAN_START] = "scan_start",
+      [TREE_SITTER_HACK_SCAN_BODY] = "scan_body",
+      [TREE_SITTER_HACK_SCAN_DELIMITER] = "scan_delimiter",
+  };
+
+  printf("%" PRIu64 " files, %" PRIu64 " bytes\n", files, bytes);
+  printf(
+      "\nexternal scans: %" PRIu64 ", rolled back: %" PRIu64 " (%" PRIu64 " characters)\n",
+      stats.scans,
+      stats.rollbacks,
+      stats.rollback_advances);
+  printf("%-16s %14s %14s %14s\n", "function", "calls", "advances", "failures");
+  for (unsigned i = 0; i < TREE_SITTER_HACK_SCAN_FUNCTION_COUNT; i++) {
+    const TreeSitterHackScanCounters *counters = &stats.functions[i];
+    printf(
+        "%-16s %14" PRIu64 " %14" PRIu64 " %14" PRIu64 "\n",
+        functions[i],
+        counters->calls,
+        counters->advances,
+        counters->failures);
+  }
+
+  print_lex_states("ts_lex", false, stats.lex_calls, top);
+  print_lex_states("ts_lex_keywords", true, stats.keyword_lex_calls, top);
+
+  return 0;
+}
@@ -0,0 +1,61 @@
+#ifndef TREE_SITTER_HACK_TOOLS_READ_FILE_H_
+#define TREE_SITTER_HACK_TOOLS_READ_FILE_H_
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+/**
+ * Read a whole file for the programs in bench/ and tools/. Returns NULL and leaves the reason in
+ * errno if the file can't be opened, is a directory, can't be seeked like a pipe, or doesn't fit
+ * in the uint32_t lengths Tree-sitter uses. The contents are NUL terminated, so they can be
+ * searched with the string functions. Free them with free.
+ *
+ *     uint32_t length;
+ *     char *source = read_file(path, &length);
+ */
+
+static inline char *read_file(const char *path, uint32_t *length) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return NULL;
+
+  // fopen succeeds on directories, where ftell then reports a meaningless size.
+  long size = -1;
+  struct stat info;
+  if (fstat(fileno(file), &info) == 0 && S_ISDIR(info.st_mode)) {
+    errno = EISDIR;
+  } else if (fseek(file, 0, SEEK_END) == 0) {
+    size = ftell(file);
+  }
+
+  if (size > UINT32_MAX) {
+    size = -1;
+    errno = EFBIG;
+  }
+
+  if (size < 0 || fseek(file, 0, SEEK_SET) != 0) {
+    // Report the error from above, not one from fclose.
+    int error = errno;
+    fclose(file);
+    errno = error;
+    return NULL;
+  }
+
+  char *source = malloc(size + 1);
+  *length = fread(source, 1, size, file);
+  source[*length] = '\0';
+
+  if (ferror(file)) {
+    fclose(file);
+    free(source);
+    errno = EIO;
+    return NULL;
+  }
+
+  fclose(file);
+  return source;
+}
+
+#endif  // TREE_SITTER_HACK_TOOLS_READ_FILE_H_
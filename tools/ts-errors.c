@@ -0,0 +1,703 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <tree_sitter/api.h>
+#include <unistd.h>
+
+#include "read_file.h"
+#include "sha256.h"
+
+/**
+ * In-process, multi-threaded version of bin/ts-errors. Reads file paths from stdin (one per line)
+ * and prints ERROR and MISSING nodes in the same format:
+ *
+ *     $ fd '\.(hack|php)$' examples/hack-sql-fake | tmp/tools/ts-errors
+ *     examples/hack-sql-fake/src/QueryContext.php
+ *     (5,1)-(5,8) ERROR
+ *     (10,3)-(10,6) MISSING ";"
+ *
+ * Each worker thread owns a parser and claims the next unparsed file from a shared index, so a
+ * worker that finishes a batch of small files picks up work instead of idling behind a worker
+ * stuck on a large one. Output is buffered per file and printed in input order.
+ *
+ * With --timeout-ms N, a file that takes longer than N ms to parse is reported as a single error
+ * instead of stalling its worker. With --slowest N, the N files that took longest per KB are listed
+ * on stderr, which is where error recovery on malformed files shows up. Files under 1KB count as
+ * 1KB so fixed per-parse costs don't crowd out the list.
+ *
+ * With --cache DIR --cache-key KEY, each file's output is stored under DIR/KEY by the SHA-256 of
+ * its contents and unchanged files aren't parsed again. KEY must change whenever parse results
+ * can, bin/test-examples uses the grammar.js sha from bin/generate-parser and the scanner's sha.
+ * Entries don't include the path, so a file is also skipped when it's copied or moved.
+ *
+ * With --json FILE, a report for dashboards is also written to FILE: files, bytes, parse time,
+ * ERROR and MISSING node counts for all files and for every directory that contains one, so
+ * totals per repo under examples/ and per directory inside it are both there, plus the --slowest
+ * files (10 by default). --label LABEL is copied into the report to tell runs apart, for example
+ * by grammar version. Cached files count towards files, bytes and nodes but have no parse time, so
+ * ms/KB only covers the files that were parsed.
+ */
+
+const TSLanguage *tree_sitter_hack(void);
+
+typedef struct {
+  char *data;
+  size_t len;
+  size_t cap;
+} Buffer;
+
+typedef struct {
+  char *path;
+  Buffer output;
+  uint32_t length;
+  double ms;
+  uint32_t errors;
+  uint32_t missing;
+  bool parsed;
+  bool timed_out;
+  bool cached;
+} File;
+
+// Totals for a --json report.
+typedef struct {
+  size_t files;
+  uint64_t bytes;
+  size_t parsed_files;
+  uint64_t parsed_bytes;
+  double ms;
+  size_t files_with_errors;
+  uint64_t errors;
+  uint64_t missing;
+  size_t timed_out;
+  size_t cached;
+  // Largest ms/KB among the parsed files.
+  const File *slowest;
+} Stats;
+
+typedef struct {
+  char *path;
+  Stats stats;
+} Directory;
+
+typedef struct {
+  File *files;
+  size_t file_count;
+  size_t next_file;
+  uint64_t timeout_micros;
+  // DIR/KEY from --cache and --cache-key, NULL without a cache.
+  char *cache;
+  size_t cache_hits;
+} Queue;
+
+static void buffer_printf(Buffer *buffer, const char *format, ...) {
+  va_list args;
+
+  for (;;) {
+    size_t available = buffer->cap - buffer->len;
+
+    va_start(args, format);
+    int length = vsnprintf(buffer->data + buffer->len, available, format, args);
+    va_end(args);
+
+    if (length < 0) return;
+    if ((size_t)length < available) {
+      buffer->len += length;
+      return;
+    }
+
+    buffer->cap = buffer->cap * 2 + length + 1;
+    buffer->data = realloc(buffer->data, buffer->cap);
+  }
+}
+
+// Returns the start of the given 0-indexed row and stores its length without the newline.
+static const char *source_line(const char *source, uint32_t length, uint32_t row, uint32_t *len) {
+  const char *line = source, *end = source + length;
+
+  for (uint32_t i = 0; i < row && line < end; i++) {
+    const char *newline = memchr(line, '\n', end - line);
+    line = newline != NULL ? newline + 1 : end;
+  }
+
+  const char *newline = memchr(line, '\n', end - line);
+  *len = (newline != NULL ? newline : end) - line;
+  return line;
+}
+
+// Append source[row][from..to] (inclusive, clamped to the line) to the message.
+static void append_columns(
+    Buffer *message,
+    const char *source,
+    uint32_t length,
+    uint32_t row,
+    uint32_t from,
+    uint32_t to) {
+  uint32_t line_length;
+  const char *line = source_line(source, length, row, &line_length);
+
+  if (from >= line_length) return;
+  if (to >= line_length) to = line_length - 1;
+  buffer_printf(message, "%.*s", (int)(to - from + 1), line + from);
+}
+
+// Use source code as the error message, like bin/ts-errors does.
+static void error_message(
+    Buffer *message,
+    const char *source,
+    uint32_t length,
+    TSPoint start,
+    TSPoint end) {
+  if (start.row == end.row) {
+    append_columns(message, source, length, start.row, start.column, end.column);
+    return;
+  }
+
+  append_columns(message, source, length, start.row, start.column, UINT32_MAX);
+  for (uint32_t row = start.row + 1; row < end.row; row++) {
+    buffer_printf(message, "\\n");
+    append_columns(message, source, length, row, 0, UINT32_MAX);
+  }
+  buffer_printf(message, "\\n");
+  append_columns(message, source, length, end.row, 0, end.column);
+
+  if (message->len > 91) message->len = 91;
+}
+
+static void report_node(Buffer *output, TSNode node, const char *source, uint32_t length) {
+  TSPoint start = ts_node_start_point(node), end = ts_node_end_point(node);
+  Buffer message = {0};
+
+  if (ts_node_is_missing(node)) {
+    const char *type = ts_node_type(node);
+    buffer_printf(&message, ts_node_is_named(node) ? "MISSING %s" : "MISSING \"%s\"", type);
+  } else {
+    error_message(&message, source, length, start, end);
+  }
+
+  // Increment numbers to match VSCode's 1-indexing. Use Hack error format.
+  buffer_printf(
+      output,
+      "(%u,%u)-(%u,%u) %.*s\n",
+      start.row + 1,
+      start.column + 1,
+      end.row + 1,
+      end.column + 1,
+      (int)message.len,
+      message.data != NULL ? message.data : "");
+
+  free(message.data);
+}
+
+// Walk the tree, only descending into subtrees that contain errors.
+static void report_errors(File *file, TSNode root, const char *source, uint32_t length) {
+  TSTreeCursor cursor = ts_tree_cursor_new(root);
+
+  for (;;) {
+    TSNode node = ts_tree_cursor_current_node(&cursor);
+
+    if (ts_node_is_missing(node)) {
+      file->missing++;
+      report_node(&file->output, node, source, length);
+    } else if (ts_node_symbol(node) == (TSSymbol)-1) {
+      file->errors++;
+      report_node(&file->output, node, source, length);
+    }
+
+    if (ts_node_has_error(node) && ts_tree_cursor_goto_first_child(&cursor)) continue;
+
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        return;
+      }
+    }
+  }
+}
+
+static double now_ms() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1e3 + time.tv_nsec / 1e6;
+}
+
+static char *cache_entry(const char *cache, const char *hash) {
+  Buffer path = {0};
+  buffer_printf(&path, "%s/%.2s/%s", cache, hash, hash + 2);
+  return path.data;
+}
+
+// Fill in the output from the cache. Returns false if the file isn't cached.
+static bool read_cache(const char *cache, const char *hash, File *file) {
+  char *path = cache_entry(cache, hash);
+  uint32_t length;
+  char *errors = read_file(path, &length);
+  free(path);
+
+  if (errors == NULL) return false;
+  if (length > 0) buffer_printf(&file->output, "%s\n%.*s", file->path, (int)length, errors);
+
+  // Count nodes from the stored lines, "(1,1)-(1,2) MISSING ..." or "(1,1)-(1,2) source text".
+  for (const char *line = errors; line < errors + length;) {
+    const char *message = strstr(line, ") ");
+    if (message != NULL && strncmp(message + 2, "MISSING ", 8) == 0) {
+      file->missing++;
+    } else {
+      file->errors++;
+    }
+
+    const char *newline = strchr(line, '\n');
+    line = newline != NULL ? newline + 1 : errors + length;
+  }
+
+  free(errors);
+  return true;
+}
+
+// Store the output without the path line. Written to a temporary file first so concurrent runs
+// never read a partial entry.
+static void write_cache(const char *cache, const char *hash, const File *file) {
+  char *path = cache_entry(cache, hash);
+  Buffer temporary = {0};
+  buffer_printf(&temporary, "%s.%ld.%lu", path, (long)getpid(), (unsigned long)pthread_self());
+
+  // The directory for the first two characters of the hash.
+  path[strlen(cache) + 3] = '\0';
+  mkdir(path, 0777);
+  path[strlen(cache) + 3] = '/';
+
+  // Files without errors have no output and an empty entry.
+  const char *errors = file->output.len > 0 ? file->output.data + strlen(file->path) + 1 : "";
+  size_t length = file->output.len > 0 ? file->output.data + file->output.len - errors : 0;
+
+  FILE *entry = fopen(temporary.data, "wb");
+  if (entry != NULL) {
+    bool written = fwrite(errors, 1, length, entry) == length;
+    if (fclose(entry) == 0 && written && rename(temporary.data, path) == 0) {
+      free(temporary.data);
+      free(path);
+      return;
+    }
+    remove(temporary.data);
+  }
+
+  fprintf(stderr, "Could not write cache entry %s: %s\n", path, strerror(errno));
+  free(temporary.data);
+  free(path);
+}
+
+static void check_file(TSParser *parser, Queue *queue, File *file) {
+  uint32_t length;
+  char *source = read_file(file->path, &length);
+
+  if (source == NULL) {
+    buffer_printf(&file->output, "%s\n(1,1)-(1,1) %s\n", file->path, strerror(errno));
+    return;
+  }
+
+  file->length = length;
+
+  char hash[SHA256_HEX_LENGTH + 1];
+  if (queue->cache != NULL) {
+    sha256_hex(source, length, hash);
+    if (read_cache(queue->cache, hash, file)) {
+      file->cached = true;
+      __atomic_fetch_add(&queue->cache_hits, 1, __ATOMIC_RELAXED);
+      free(source);
+      return;
+    }
+  }
+
+  double start = now_ms();
+  TSTree *tree = ts_parser_parse_string(parser, NULL, source, length);
+  file->ms = now_ms() - start;
+  file->parsed = true;
+
+  if (tree == NULL) {
+    // Reset so the next file doesn't resume this parse.
+    ts_parser_reset(parser);
+    file->timed_out = true;
+    buffer_printf(
+        &file->output, "%s\n(1,1)-(1,1) Timed out after %.0f ms\n", file->path, file->ms);
+    free(source);
+    return;
+  }
+
+  TSNode root = ts_tree_root_node(tree);
+
+  if (ts_node_has_error(root)) {
+    buffer_printf(&file->output, "%s\n", file->path);
+    report_errors(file, root, source, length);
+  }
+
+  // Timed out files returned early. They aren't cached since timeouts depend on the machine.
+  if (queue->cache != NULL) write_cache(queue->cache, hash, file);
+
+  ts_tree_delete(tree);
+  free(source);
+}
+
+static void *worker(void *payload) {
+  Queue *queue = payload;
+
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_hack());
+  ts_parser_set_timeout_micros(parser, queue->timeout_micros);
+
+  for (;;) {
+    size_t index = __atomic_fetch_add(&queue->next_file, 1, __ATOMIC_RELAXED);
+    if (index >= queue->file_count) break;
+    check_file(parser, queue, &queue->files[index]);
+  }
+
+  ts_parser_delete(parser);
+  return NULL;
+}
+
+static double ms_per_kb(const File *file) {
+  return file->ms * 1024 / (file->length > 1024 ? file->length : 1024);
+}
+
+static int compare_ms_per_kb(const void *a, const void *b) {
+  double x = ms_per_kb(*(File *const *)a), y = ms_per_kb(*(File *const *)b);
+  return (x < y) - (x > y);
+}
+
+static void print_slowest(File *files, size_t count, size_t slowest) {
+  File **sorted = malloc((count > 0 ? count : 1) * sizeof(File *));
+  for (size_t i = 0; i < count; i++) sorted[i] = &files[i];
+  qsort(sorted, count, sizeof(File *), compare_ms_per_kb);
+
+  fprintf(stderr, "\nSlowest files by ms/KB:\n");
+  fprintf(stderr, "%10s %10s %10s  %s\n", "ms/KB", "ms", "KB", "path");
+  for (size_t i = 0; i < count && i < slowest; i++) {
+    fprintf(
+        stderr,
+        "%10.3f %10.1f %10.1f  %s\n",
+        ms_per_kb(sorted[i]),
+        sorted[i]->ms,
+        sorted[i]->length / 1024.0,
+        sorted[i]->path);
+  }
+
+  free(sorted);
+}
+
+static void add_stats(Stats *stats, const File *file) {
+  stats->files++;
+  stats->bytes += file->length;
+  if (file->output.len > 0) stats->files_with_errors++;
+  stats->errors += file->errors;
+  stats->missing += file->missing;
+  if (file->timed_out) stats->timed_out++;
+  if (file->cached) stats->cached++;
+
+  if (file->parsed) {
+    stats->parsed_files++;
+    stats->parsed_bytes += file->length;
+    stats->ms += file->ms;
+    if (stats->slowest == NULL || ms_per_kb(file) > ms_per_kb(stats->slowest)) {
+      stats->slowest = file;
+    }
+  }
+}
+
+static void json_string(FILE *out, const char *string) {
+  fputc('"', out);
+  for (const unsigned char *c = (const unsigned char *)string; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') {
+      fprintf(out, "\\%c", *c);
+    } else if (*c < 0x20) {
+      fprintf(out, "\\u%04x", *c);
+    } else {
+      fputc(*c, out);
+    }
+  }
+  fputc('"', out);
+}
+
+static void json_file(FILE *out, const File *file) {
+  fprintf(out, "{\"path\": ");
+  json_string(out, file->path);
+  fprintf(
+      out,
+      ", \"bytes\": %u, \"ms\": %.3f, \"ms_per_kb\": %.3f, \"errors\": %u, \"missing\": %u, "
+      "\"timed_out\": %s}",
+      file->length,
+      file->ms,
+      ms_per_kb(file),
+      file->errors,
+      file->missing,
+      file->timed_out ? "true" : "false");
+}
+
+static void json_stats(FILE *out, const Stats *stats) {
+  fprintf(
+      out,
+      "\"files\": %zu, \"bytes\": %" PRIu64 ", \"parsed_files\": %zu, \"parsed_bytes\": %" PRIu64
+      ", \"ms\": %.3f, \"ms_per_kb\": %.3f, \"files_with_errors\": %zu, \"errors\": %" PRIu64
+      ", \"missing\": %" PRIu64 ", \"timed_out\": %zu, \"cached\": %zu, \"slowest\": ",
+      stats->files,
+      stats->bytes,
+      stats->parsed_files,
+      stats->parsed_bytes,
+      stats->ms,
+      stats->parsed_bytes > 0 ? stats->ms * 1024 / stats->parsed_bytes : 0,
+      stats->files_with_errors,
+      stats->errors,
+      stats->missing,
+      stats->timed_out,
+      stats->cached);
+
+  if (stats->slowest != NULL) {
+    json_file(out, stats->slowest);
+  } else {
+    fprintf(out, "null");
+  }
+}
+
+static int compare_directories(const void *a, const void *b) {
+  return strcmp(((const Directory *)a)->path, ((const Directory *)b)->path);
+}
+
+// The directory of path that ends at slash, or "." if there's no slash. The root of an absolute
+// path is "/".
+static char *ancestor(const char *path, const char *slash) {
+  if (slash == NULL) return strdup(".");
+  if (slash == path) return strdup("/");
+  return strndup(path, slash - path);
+}
+
+// Every directory that contains one of the files, directly or not, sorted by path. Files without
+// a directory are counted under ".".
+static Directory *directories(File *files, size_t count, size_t *directory_count) {
+  size_t capacity = 1024, length = 0;
+  Directory *directories = malloc(capacity * sizeof(Directory));
+
+  for (size_t i = 0; i < count; i++) {
+    const char *path = files[i].path;
+    const char *slash = strchr(path, '/');
+
+    do {
+      if (length == capacity) {
+        capacity *= 2;
+        directories = realloc(directories, capacity * sizeof(Directory));
+      }
+
+      directories[length++] = (Directory){.path = ancestor(path, slash)};
+    } while (slash != NULL && (slash = strchr(slash + 1, '/')) != NULL);
+  }
+
+  qsort(directories, length, sizeof(Directory), compare_directories);
+
+  size_t unique = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (unique > 0 && strcmp(directories[unique - 1].path, directories[i].path) == 0) {
+      free(directories[i].path);
+    } else {
+      directories[unique++] = directories[i];
+    }
+  }
+
+  *directory_count = unique;
+  return directories;
+}
+
+static Directory *find_directory(Directory *directories, size_t count, const char *path) {
+  Directory key = {.path = (char *)path};
+  return bsearch(&key, directories, count, sizeof(Directory), compare_directories);
+}
+
+static void write_json(
+    const char *path,
+    const char *label,
+    File *files,
+    size_t count,
+    size_t slowest,
+    long jobs,
+    double wall_ms) {
+  FILE *out = fopen(path, "w");
+  if (out == NULL) {
+    fprintf(stderr, "Could not write %s: %s\n", path, strerror(errno));
+    exit(1);
+  }
+
+  Stats total = {0};
+  size_t directory_count;
+  Directory *dirs = directories(files, count, &directory_count);
+
+  for (size_t i = 0; i < count; i++) {
+    add_stats(&total, &files[i]);
+
+    // Every directory containing the file, like directories().
+    const char *file_path = files[i].path;
+    const char *slash = strchr(file_path, '/');
+
+    do {
+      char *directory = ancestor(file_path, slash);
+      add_stats(&find_directory(dirs, directory_count, directory)->stats, &files[i]);
+      free(directory);
+    } while (slash != NULL && (slash = strchr(slash + 1, '/')) != NULL);
+  }
+
+  fprintf(out, "{\n  \"label\": ");
+  json_string(out, label != NULL ? label : "");
+  fprintf(out, ",\n  \"jobs\": %ld,\n  \"wall_ms\": %.3f,\n  \"total\": {", jobs, wall_ms);
+  json_stats(out, &total);
+  fprintf(out, "},\n  \"directories\": [");
+
+  for (size_t i = 0; i < directory_count; i++) {
+    fprintf(out, "%s\n    {\"path\": ", i > 0 ? "," : "");
+    json_string(out, dirs[i].path);
+    fprintf(out, ", ");
+    json_stats(out, &dirs[i].stats);
+    fprintf(out, "}");
+    free(dirs[i].path);
+  }
+
+  File **sorted = malloc((count > 0 ? count : 1) * sizeof(File *));
+  for (size_t i = 0; i < count; i++) sorted[i] = &files[i];
+  qsort(sorted, count, sizeof(File *), compare_ms_per_kb);
+
+  fprintf(out, "\n  ],\n  \"slowest\": [");
+  for (size_t i = 0; i < count && i < slowest; i++) {
+    fprintf(out, "%s\n    ", i > 0 ? "," : "");
+    json_file(out, sorted[i]);
+  }
+  fprintf(out, "\n  ]\n}\n");
+
+  fclose(out);
+  free(sorted);
+  free(dirs);
+}
+
+static void usage() {
+  fprintf(
+      stderr,
+      "usage: ts-errors [--jobs N] [--timeout-ms N] [--slowest N]"
+      " [--cache DIR --cache-key KEY] [--json FILE [--label LABEL]] < paths\n");
+  exit(1);
+}
+
+// Create DIR/KEY for the cache. KEY becomes a directory name so it's limited to a safe set of
+// characters.
+static char *open_cache(const char *directory, const char *key) {
+  if (key == NULL || key[0] == '\0' || key[0] == '.' ||
+      key[strspn(key, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789._-")] !=
+          '\0') {
+    fprintf(stderr, "--cache needs a --cache-key of letters, digits, '.', '_' and '-'\n");
+    exit(1);
+  }
+
+  Buffer cache = {0};
+  buffer_printf(&cache, "%s/%s", directory, key);
+
+  mkdir(directory, 0777);
+  if (mkdir(cache.data, 0777) != 0 && errno != EEXIST) {
+    fprintf(stderr, "Could not create cache %s: %s\n", cache.data, strerror(errno));
+    exit(1);
+  }
+
+  return cache.data;
+}
+
+int main(int argc, char **argv) {
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  double timeout_ms = 0;
+  long slowest = 0;
+  const char *cache = NULL, *cache_key = NULL;
+  const char *json = NULL, *label = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+      jobs = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--timeout-ms") == 0 && i + 1 < argc) {
+      timeout_ms = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--slowest") == 0 && i + 1 < argc) {
+      slowest = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+      cache = argv[++i];
+    } else if (strcmp(argv[i], "--cache-key") == 0 && i + 1 < argc) {
+      cache_key = argv[++i];
+    } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json = argv[++i];
+    } else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+      label = argv[++i];
+    } else {
+      usage();
+    }
+  }
+
+  if (jobs < 1) jobs = 1;
+
+  Queue queue = {
+      .files = NULL,
+      .file_count = 0,
+      .next_file = 0,
+      .timeout_micros = timeout_ms > 0 ? timeout_ms * 1000 : 0,
+      .cache = cache != NULL ? open_cache(cache, cache_key) : NULL,
+      .cache_hits = 0,
+  };
+  size_t capacity = 0;
+
+  char *line = NULL;
+  size_t line_cap = 0;
+  ssize_t line_length;
+
+  while ((line_length = getline(&line, &line_cap, stdin)) > 0) {
+    if (line[line_length - 1] == '\n') line[--line_length] = '\0';
+    if (line_length == 0) continue;
+
+    if (queue.file_count == capacity) {
+      capacity = capacity ? capacity * 2 : 1024;
+      queue.files = realloc(queue.files, capacity * sizeof(File));
+    }
+    queue.files[queue.file_count++] =
+        (File){.path = strdup(line), .output = {0}};
+  }
+  free(line);
+
+  if ((size_t)jobs > queue.file_count) jobs = queue.file_count ? queue.file_count : 1;
+
+  double start = now_ms();
+  pthread_t *threads = malloc(jobs * sizeof(pthread_t));
+  for (long i = 0; i < jobs; i++) pthread_create(&threads[i], NULL, worker, &queue);
+  for (long i = 0; i < jobs; i++) pthread_join(threads[i], NULL);
+  free(threads);
+  double wall_ms = now_ms() - start;
+
+  for (size_t i = 0; i < queue.file_count; i++) {
+    File *file = &queue.files[i];
+    fwrite(file->output.data, 1, file->output.len, stdout);
+  }
+
+  fflush(stdout);
+  if (slowest > 0) print_slowest(queue.files, queue.file_count, slowest);
+  if (json != NULL) {
+    size_t json_slowest = slowest > 0 ? slowest : 10;
+    write_json(json, label, queue.files, queue.file_count, json_slowest, jobs, wall_ms);
+  }
+  if (queue.cache != NULL) {
+    fprintf(
+        stderr,
+        "\n%zu of %zu files unchanged in %s\n",
+        queue.cache_hits,
+        queue.file_count,
+        queue.cache);
+    free(queue.cache);
+  }
+
+  for (size_t i = 0; i < queue.file_count; i++) {
+    free(queue.files[i].output.data);
+    free(queue.files[i].path);
+  }
+  free(queue.files);
+
+  return 0;
+}